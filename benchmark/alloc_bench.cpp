@@ -0,0 +1,139 @@
+// Count heap allocations on schedule & fire path in steady state.
+// Timer runs callbacks inline by pollOnce(), so only timer path is counted.
+// Then time node pool shared by 1..8 threads.
+// Usage: alloc_bench [ops]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "manager_timer.h"
+
+static std::atomic<size_t> alloc_count(0);
+
+void* operator new(size_t size) {
+    ++alloc_count;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static size_t fired = 0;
+
+static void onFire(int, int) {
+    ++fired;
+}
+
+enum class Path {
+    Post,
+    Future,
+    Repeat
+};
+
+static const char* pathName(Path path) {
+    switch (path) {
+        case Path::Post: return "postJobRunAt";
+        case Path::Future: return "addJobRunAt";
+        default: return "addJobRunEvery";
+    }
+}
+
+static bool setup(ManagerTimer& mt, bool wheel) {
+    if (wheel && !mt.setTimingWheel(std::chrono::milliseconds(1))) {
+        return false;
+    }
+    return mt.setAlarmType(ManagerTimer::AlarmType::TimerFd) && mt.init();
+}
+
+// Return allocations per fire.
+static double runBench(Path path, bool wheel, size_t ops) {
+    ManagerTimer mt;
+    if (!setup(mt, wheel)) {
+        return -1;
+    }
+    ManagerTimer::TimerHandle repeat;
+    if (path == Path::Repeat) {
+        repeat = mt.addJobRunEvery(std::chrono::microseconds(100), onFire, 1, 2);
+    }
+    auto once = [&mt, path]() {
+        auto expiration = ManagerTimer::Clock::now() - std::chrono::milliseconds(1);
+        if (path == Path::Post) {
+            mt.postJobRunAt(expiration, onFire, 1, 2);
+        } else if (path == Path::Future) {
+            mt.addJobRunAt(expiration, onFire, 1, 2);
+        }
+        size_t last = fired;
+        while (fired == last) {
+            mt.pollOnce(path == Path::Repeat ? -1 : 0);
+        }
+    };
+    // Warm up node pool.
+    for (size_t i = 0; i < 1000; ++i) {
+        once();
+    }
+    size_t allocs = alloc_count;
+    size_t begin = fired;
+    for (size_t i = 0; i < ops; ++i) {
+        once();
+    }
+    allocs = alloc_count - allocs;
+    return static_cast<double>(allocs) / static_cast<double>(fired - begin);
+}
+
+// Threads allocate & free timer nodes of one pool, as producers & pool
+// threads of a manager do. Return ns per allocate & deallocate.
+static double runContended(size_t threads, size_t ops) {
+    PoolAllocator<Timer> alloc(std::make_shared<TimerNodePool>());
+    std::vector<std::thread> workers;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([alloc, ops]() mutable {
+            std::vector<Timer*> nodes(64);
+            for (size_t j = 0; j < ops; j += nodes.size()) {
+                for (auto& node : nodes) {
+                    node = alloc.allocate(1);
+                }
+                for (auto& node : nodes) {
+                    alloc.deallocate(node, 1);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto elapse = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            elapse).count()) / static_cast<double>(threads * ops);
+}
+
+int main(int argc, char* argv[]) {
+    size_t ops = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+    printf("%-16s %-8s %16s\n", "path", "storage", "allocs/fire");
+    for (Path path : {Path::Post, Path::Future, Path::Repeat}) {
+        for (bool wheel : {false, true}) {
+            double allocs = runBench(path, wheel, ops);
+            printf("%-16s %-8s %16.3f\n", pathName(path),
+                    wheel ? "wheel" : "map", allocs);
+        }
+    }
+    printf("\n%-16s %16s\n", "pool threads", "ns/alloc+free");
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+        printf("%-16zu %16.1f\n", threads, runContended(threads, ops * 50));
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Cost of clock sources of BasicManagerTimer:
+//  - ns per now() & observed resolution, 1..N threads reading at once
+//  - add throughput (postJobRunAfter) of a manager using each source
+// Usage: clock_bench [threads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "manager_timer.h"
+
+using Clock = ManagerTimer::Clock;
+
+static void noop() { }
+
+static double seconds(const Clock::time_point& begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+template <typename Policy>
+static void benchRead(const char* name, size_t threads) {
+    const size_t reads = 5000000;
+    Policy::init();
+    Policy::wakeup();
+    std::vector<std::thread> readers;
+    std::atomic<long long> sink(0);
+    std::atomic<long long> resolution(INT64_MAX);
+    auto begin = Clock::now();
+    for (size_t i = 0; i < threads; ++i) {
+        readers.emplace_back([&sink, &resolution, reads]() {
+            long long sum = 0;
+            long long step = INT64_MAX;
+            auto last = Policy::now();
+            for (size_t j = 0; j < reads; ++j) {
+                auto now = Policy::now();
+                auto diff = (now - last).count();
+                if (diff > 0 && diff < step) {
+                    step = diff;
+                }
+                sum += now.time_since_epoch().count();
+                last = now;
+            }
+            sink += sum;
+            long long current = resolution;
+            while (step < current && !resolution.compare_exchange_weak(current, step)) { }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    double ns = seconds(begin) * 1e9 / static_cast<double>(reads);
+    long long step = resolution;
+    printf("  %-10s %2zu threads %8.1f ns/read, resolution %lld ns\n",
+            name, threads, ns, step == INT64_MAX ? -1LL : step);
+}
+
+template <typename Policy>
+static void benchAdd(const char* name) {
+    const size_t jobs = 500000;
+    BasicManagerTimer<Policy> mt;
+    mt.init();
+    mt.start();
+    auto begin = Clock::now();
+    for (size_t i = 0; i < jobs; ++i) {
+        mt.postJobRunAfter(std::chrono::hours(1), noop);
+    }
+    double elapse = seconds(begin);
+    mt.stopAndJoin();
+    printf("  %-10s %14.0f adds/s\n", name, static_cast<double>(jobs) / elapse);
+}
+
+int main(int argc, char* argv[]) {
+    size_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) :
+            std::max(4u, std::thread::hardware_concurrency());
+    printf("[now()]\n");
+    for (size_t n = 1; n <= threads; n *= 2) {
+        benchRead<SteadyClockPolicy>("steady", n);
+        benchRead<CoarseClockPolicy>("coarse", n);
+        benchRead<TscClockPolicy>("tsc", n);
+        benchRead<CachedClockPolicy<>>("cached", n);
+    }
+    printf("[add]\n");
+    benchAdd<SteadyClockPolicy>("steady");
+    benchAdd<CoarseClockPolicy>("coarse");
+    benchAdd<TscClockPolicy>("tsc");
+    benchAdd<CachedClockPolicy<>>("cached");
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Cost of calendar jobs:
+//  - next fire time by CronSchedule vs localtime_r + mktime (what addJobRepeatAt* did)
+//  - add many cron jobs, sharing one schedule or one schedule each
+// Usage: cron_bench [jobs] [threads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "manager_timer.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds(const Clock::time_point& begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Next 10:30:00 of local time by libc, what addJobRepeatAtDay used to do.
+static time_t libcNext(time_t after) {
+    struct tm calendar{};
+    localtime_r(&after, &calendar);
+    calendar.tm_hour = 10;
+    calendar.tm_min = 30;
+    calendar.tm_sec = 0;
+    time_t next = mktime(&calendar);
+    if (next <= after) {
+        ++calendar.tm_mday;
+        calendar.tm_isdst = -1;
+        next = mktime(&calendar);
+    }
+    return next;
+}
+
+static void benchNext(size_t threads) {
+    const size_t ops = 200000;
+    auto schedule = CronSchedule::at(10, 30, 0);
+    for (int libc = 0; libc < 2; ++libc) {
+        std::vector<std::thread> workers;
+        std::atomic<long long> sink(0);
+        auto begin = Clock::now();
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([&schedule, &sink, libc, ops, i]() {
+                auto after = std::chrono::system_clock::now() + std::chrono::hours(i);
+                long long sum = 0;
+                for (size_t j = 0; j < ops; ++j) {
+                    if (libc != 0) {
+                        after = std::chrono::system_clock::from_time_t(
+                                libcNext(std::chrono::system_clock::to_time_t(after)));
+                    } else {
+                        after = schedule->next(after);
+                    }
+                    sum += after.time_since_epoch().count();
+                }
+                sink += sum;
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double elapse = seconds(begin);
+        printf("  %-6s %2zu threads %14.0f next/s\n", libc != 0 ? "libc" : "cron",
+                threads, static_cast<double>(threads * ops) / elapse);
+    }
+}
+
+static void benchAdd(size_t jobs) {
+    ManagerTimer mt;
+    mt.init();
+    mt.start();
+    auto schedule = CronSchedule::parse("0 */5 * * * *");
+    auto begin = Clock::now();
+    for (size_t i = 0; i < jobs; ++i) {
+        mt.addJobCron(TimerOptions(), schedule, []() { });
+    }
+    double shared = seconds(begin);
+    begin = Clock::now();
+    for (size_t i = 0; i < jobs; ++i) {
+        mt.addJobRepeatAtDay(static_cast<uint>(i % 24), static_cast<uint>(i % 60), 0, []() { });
+    }
+    double each = seconds(begin);
+    mt.stopAndJoin();
+    printf("  add    %zu jobs: shared schedule %.1f ms, addJobRepeatAtDay %.1f ms\n",
+            jobs, shared * 1e3, each * 1e3);
+}
+
+int main(int argc, char* argv[]) {
+    size_t jobs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    size_t threads = argc > 2 ? strtoul(argv[2], nullptr, 10) :
+            std::max(4u, std::thread::hardware_concurrency());
+    printf("[next fire time]\n");
+    for (size_t n = 1; n <= threads; n *= 2) {
+        benchNext(n);
+    }
+    printf("[cron jobs]\n");
+    benchAdd(jobs);
+    return 0;
+}
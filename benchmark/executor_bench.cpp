@@ -0,0 +1,131 @@
+// Dispatch ThreadPool vs WorkStealingExecutor vs PriorityExecutor under
+// bursty expirations. Every burst is a batch of timers expiring at the same
+// time point. Then a flood of low priority timers with a few high priority
+// ones expiring 1ms later, queue wait of both classes are reported.
+// Usage: executor_bench [threads] [bursts] [timers_per_burst] [work_ns]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "manager_timer.h"
+#include "priority_executor.h"
+#include "work_stealing_executor.h"
+#include "ThreadPool.h"
+
+using Clock = ManagerTimer::Clock;
+using Accuracy = ManagerTimer::Accuracy;
+
+static std::atomic<size_t> done(0);
+
+static void work(long work_ns) {
+    auto end = Clock::now() + std::chrono::nanoseconds(work_ns);
+    while (Clock::now() < end) { }
+    ++done;
+}
+
+static void runBench(const char* name, ThreadPool* tp, TimerExecutor* executor,
+        size_t bursts, size_t timers, long work_ns) {
+    ManagerTimer mt(tp);
+    mt.setExecutor(executor);
+    mt.init();
+    mt.start();
+    done = 0;
+    auto first = Clock::now() + std::chrono::milliseconds(20);
+    for (size_t i = 0; i < bursts; ++i) {
+        auto expiration = std::chrono::time_point_cast<Accuracy>(
+                first + std::chrono::milliseconds(5 * i));
+        ManagerTimer::ScheduleBatch batch(mt);
+        batch.reserve(timers);
+        for (size_t j = 0; j < timers; ++j) {
+            batch.addJobRunAt(expiration, work, work_ns);
+        }
+        mt.schedule(batch);
+    }
+    while (done < bursts * timers) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapse = std::chrono::duration<double>(Clock::now() - first).count();
+    mt.stopAndJoin();
+    auto stats = mt.stats();
+    printf("%-14s %14.0f jobs/s   queue wait p50 %8lu ns  p99 %10lu ns  max %10lu ns\n",
+            name, static_cast<double>(bursts * timers) / elapse,
+            static_cast<unsigned long>(stats.queue_wait.percentile(0.5)),
+            static_cast<unsigned long>(stats.queue_wait.percentile(0.99)),
+            static_cast<unsigned long>(stats.queue_wait.max));
+}
+
+static void printWait(const char* name, const HistogramSnapshot& wait) {
+    printf("  %-6s queue wait p50 %10lu ns  p99 %10lu ns  max %10lu ns\n", name,
+            static_cast<unsigned long>(wait.percentile(0.5)),
+            static_cast<unsigned long>(wait.percentile(0.99)),
+            static_cast<unsigned long>(wait.max));
+}
+
+static void runPriorityBench(const char* name, ThreadPool* tp, TimerExecutor* executor,
+        size_t bursts, size_t timers, long work_ns) {
+    const size_t high_timers = 10;
+    ManagerTimer mt(tp);
+    mt.setExecutor(executor);
+    mt.init();
+    mt.start();
+    done = 0;
+    auto first = Clock::now() + std::chrono::milliseconds(20);
+    for (size_t i = 0; i < bursts; ++i) {
+        auto expiration = std::chrono::time_point_cast<Accuracy>(
+                first + std::chrono::milliseconds(5 * i));
+        for (size_t j = 0; j < timers; ++j) {
+            mt.postJobRunAt(TimerOptions().setPriority(TimerPriority::Low),
+                    expiration, work, work_ns);
+        }
+        for (size_t j = 0; j < high_timers; ++j) {
+            mt.postJobRunAt(TimerOptions().setPriority(TimerPriority::High),
+                    expiration + std::chrono::milliseconds(1), work, work_ns);
+        }
+    }
+    while (done < bursts * (timers + high_timers)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mt.stopAndJoin();
+    auto stats = mt.stats();
+    printf("%s\n", name);
+    printWait("High", stats.class_queue_wait[static_cast<size_t>(TimerPriority::High)]);
+    printWait("Low", stats.class_queue_wait[static_cast<size_t>(TimerPriority::Low)]);
+}
+
+int main(int argc, char* argv[]) {
+    size_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+    size_t bursts = argc > 2 ? strtoul(argv[2], nullptr, 10) : 50;
+    size_t timers = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2000;
+    long work_ns = argc > 4 ? strtol(argv[4], nullptr, 10) : 1000;
+    printf("%zu threads, %zu bursts x %zu timers, %ld ns work\n",
+            threads, bursts, timers, work_ns);
+    {
+        ThreadPool pool(threads);
+        runBench("ThreadPool", &pool, nullptr, bursts, timers, work_ns);
+    }
+    {
+        WorkStealingExecutor executor(threads);
+        runBench("WorkStealing", nullptr, &executor, bursts, timers, work_ns);
+    }
+    {
+        PriorityExecutor executor(threads);
+        runBench("Priority", nullptr, &executor, bursts, timers, work_ns);
+    }
+    printf("Low priority flood, high priority timers expire 1ms later\n");
+    {
+        ThreadPool pool(threads);
+        runPriorityBench("ThreadPool", &pool, nullptr, bursts, timers, work_ns);
+    }
+    {
+        WorkStealingExecutor executor(threads);
+        runPriorityBench("WorkStealing", nullptr, &executor, bursts, timers, work_ns);
+    }
+    {
+        PriorityExecutor executor(threads);
+        runPriorityBench("Priority", nullptr, &executor, bursts, timers, work_ns);
+    }
+    return 0;
+}
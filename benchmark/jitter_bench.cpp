@@ -0,0 +1,76 @@
+// Firing lag (run time - expiration) of default mode vs high precision
+// mode, for both alarm types. Timers are spaced by interval so every one
+// has its own wakeup, callbacks run inline.
+// Usage: jitter_bench [samples] [interval_us] [spin_us] [cpu]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "manager_timer.h"
+
+using Clock = ManagerTimer::Clock;
+using Accuracy = ManagerTimer::Accuracy;
+
+static long percentile(const std::vector<long>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+static void runBench(const char* name, ManagerTimer::AlarmType type,
+        size_t samples, long interval_us, long spin_us, int cpu) {
+    ManagerTimer mt;
+    mt.setAlarmType(type);
+    if (spin_us > 0) {
+        mt.setPrecisionMode(std::chrono::microseconds(spin_us), cpu);
+    }
+    if (!mt.init() || !mt.start()) {
+        printf("%-24s init failed\n", name);
+        return;
+    }
+    std::vector<long> lags(samples, 0);
+    auto first = std::chrono::time_point_cast<Accuracy>(
+            Clock::now() + std::chrono::milliseconds(50));
+    for (size_t i = 0; i < samples; ++i) {
+        auto expiration = first + std::chrono::microseconds(interval_us * static_cast<long>(i));
+        long* lag = &lags[i];
+        mt.postJobRunAt(expiration, [lag, expiration]() {
+            *lag = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - expiration).count());
+        });
+    }
+    std::this_thread::sleep_until(first + std::chrono::microseconds(
+            interval_us * static_cast<long>(samples)) + std::chrono::milliseconds(50));
+    mt.stopAndJoin();
+    std::sort(lags.begin(), lags.end());
+    printf("%-24s lag p50 %8ld ns  p99 %8ld ns  p99.9 %8ld ns  max %8ld ns\n",
+            name, percentile(lags, 0.5), percentile(lags, 0.99),
+            percentile(lags, 0.999), lags.back());
+}
+
+int main(int argc, char* argv[]) {
+    size_t samples = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    long interval_us = argc > 2 ? strtol(argv[2], nullptr, 10) : 500;
+    long spin_us = argc > 3 ? strtol(argv[3], nullptr, 10) : 200;
+    int cpu = argc > 4 ? atoi(argv[4]) : -1;
+    if (samples == 0 || spin_us <= 0) {
+        printf("Usage: jitter_bench [samples] [interval_us] [spin_us] [cpu]\n");
+        return 1;
+    }
+    printf("%zu samples every %ld us, spin %ld us, cpu %d\n",
+            samples, interval_us, spin_us, cpu);
+    runBench("PosixTimer", ManagerTimer::AlarmType::PosixTimer,
+            samples, interval_us, 0, -1);
+    runBench("PosixTimer precision", ManagerTimer::AlarmType::PosixTimer,
+            samples, interval_us, spin_us, cpu);
+#ifdef __linux__
+    runBench("TimerFd", ManagerTimer::AlarmType::TimerFd,
+            samples, interval_us, 0, -1);
+    runBench("TimerFd precision", ManagerTimer::AlarmType::TimerFd,
+            samples, interval_us, spin_us, cpu);
+#endif
+    return 0;
+}
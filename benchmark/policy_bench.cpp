@@ -0,0 +1,84 @@
+// Compile time policies against the runtime configurable ManagerTimer,
+// callbacks run inline:
+//  - add & cancel cost with timers already pending
+//  - time to fire timers sharing the same deadline
+// Usage: policy_bench [max_pending]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "manager_timer.h"
+
+using Clock = ManagerTimer::Clock;
+using Accuracy = ManagerTimer::Accuracy;
+
+static void noop() { }
+
+static double seconds(const Clock::time_point& begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+template <typename MT>
+static void benchAddCancel(MT& mt, size_t pending) {
+    std::vector<ManagerTimer::TimerHandle> timers;
+    timers.reserve(pending);
+    auto begin = Clock::now();
+    for (size_t i = 0; i < pending; ++i) {
+        // Spread over one hour, so the order of storage matters.
+        timers.push_back(mt.postJobRunAfter(
+                std::chrono::hours(1) + std::chrono::microseconds((i * 7919) % 3600000), noop));
+    }
+    double add_ns = seconds(begin) * 1e9 / static_cast<double>(pending);
+    begin = Clock::now();
+    for (auto& timer : timers) {
+        mt.cancel(timer);
+    }
+    double cancel_ns = seconds(begin) * 1e9 / static_cast<double>(pending);
+    printf("    add %.1f ns/op, cancel %.1f ns/op\n", add_ns, cancel_ns);
+}
+
+template <typename MT>
+static void benchBurst(MT& mt, size_t pending) {
+    std::atomic<size_t> fired(0);
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            Clock::now() + std::chrono::milliseconds(100) +
+            std::chrono::microseconds(2 * pending));
+    for (size_t i = 0; i < pending; ++i) {
+        mt.postJobRunAt(expiration, [&fired]() { ++fired; });
+    }
+    while (fired < pending) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto elapse = std::chrono::duration<double>(Clock::now() - expiration).count();
+    printf("    burst %.1f ms to fire all\n", elapse * 1e3);
+}
+
+template <typename MT>
+static void runBench(const char* name, size_t pending) {
+    printf("  %s\n", name);
+    MT mt;
+    mt.init();
+    mt.start();
+    benchAddCancel(mt, pending);
+    benchBurst(mt, pending);
+    mt.stopAndJoin();
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_pending = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    for (size_t pending = 1000; pending <= max_pending; pending *= 10) {
+        printf("[pending %zu]\n", pending);
+        runBench<ManagerTimer>("ManagerTimer (map, dynamic dispatch)", pending);
+        runBench<BasicManagerTimer<SteadyClockPolicy, TimerMapStorage, InlineDispatch>>(
+                "map, inline", pending);
+        runBench<BasicManagerTimer<SteadyClockPolicy, TimerHeapStorage, InlineDispatch>>(
+                "heap, inline", pending);
+        runBench<BasicManagerTimer<SteadyClockPolicy, TimingWheelStorage, InlineDispatch>>(
+                "wheel 1ms, inline", pending);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Add throughput of ShardedManagerTimer with different shard count.
+// Usage: shard_bench [producer_threads] [jobs_per_thread]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "sharded_manager_timer.h"
+
+static void noop() { }
+
+static double runBench(size_t shard_num, size_t threads, size_t jobs) {
+    ShardedManagerTimer mt(shard_num);
+    mt.init();
+    mt.start();
+    std::vector<std::thread> producers;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threads; ++i) {
+        producers.emplace_back([&mt, jobs]() {
+            for (size_t j = 0; j < jobs; ++j) {
+                mt.addJobRunEvery(std::chrono::hours(1), noop);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    auto elapse = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+    mt.stopAndJoin();
+    return static_cast<double>(threads * jobs) / elapse;
+}
+
+int main(int argc, char* argv[]) {
+    size_t threads = argc > 1 ? strtoul(argv[1], nullptr, 10) :
+            std::max(4u, std::thread::hardware_concurrency());
+    size_t jobs = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+    printf("%8s %8s %16s\n", "shards", "threads", "adds/s");
+    for (size_t shard_num = 1; shard_num <= threads; shard_num *= 2) {
+        double rate = runBench(shard_num, threads, jobs);
+        printf("%8zu %8zu %16.0f\n", shard_num, threads, rate);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Restore of persistent jobs: snapshot N jobs, then time restore() into
+// a fresh manager (map storage).
+// Usage: snapshot_bench [jobs] [path]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "manager_timer.h"
+
+using Clock = ManagerTimer::Clock;
+
+static void noop(const char*, size_t) { }
+
+static double seconds(const Clock::time_point& begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+    size_t jobs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+    const char* path = argc > 2 ? argv[2] : "snapshot_bench.snap";
+    char err[1024];
+    {
+        ManagerTimer mt;
+        mt.registerCallback(1, noop);
+        mt.init();
+        for (size_t i = 0; i < jobs; ++i) {
+            mt.addPersistentJobRunAfter(std::chrono::hours(1) + std::chrono::microseconds(i),
+                    1, &i, sizeof(i));
+        }
+        auto begin = Clock::now();
+        if (!mt.snapshot(path, err)) {
+            printf("snapshot failed: %s\n", err);
+            return 1;
+        }
+        printf("snapshot %zu jobs: %.3f s\n", jobs, seconds(begin));
+    }
+    ManagerTimer mt;
+    mt.registerCallback(1, noop);
+    mt.init();
+    auto begin = Clock::now();
+    if (!mt.restore(path, err)) {
+        printf("restore failed: %s\n", err);
+        return 1;
+    }
+    double elapse = seconds(begin);
+    printf("restore  %zu jobs: %.3f s (%.1f ns/job)\n", jobs, elapse,
+            elapse * 1e9 / static_cast<double>(jobs));
+    remove(path);
+    return 0;
+}
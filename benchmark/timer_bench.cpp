@@ -0,0 +1,220 @@
+// Hot path benchmark of ManagerTimer, with callbacks run inline and in
+// thread pool:
+//  - add throughput of 1..N producer threads
+//  - firing lag percentiles (run time - expiration)
+//  - time to fire timers sharing the same deadline
+//  - cost of cancel & stopRepeat
+//  - cost of pushing idle timeouts later, extend vs cancel & add again
+//  - memory per pending timer
+// Every case runs with 1k .. max_pending timers already pending.
+// Usage: timer_bench [max_pending] [producer_threads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+#include "manager_timer.h"
+#include "ThreadPool.h"
+
+using Clock = ManagerTimer::Clock;
+using Accuracy = ManagerTimer::Accuracy;
+
+static void noop() { }
+
+static double seconds(const Clock::time_point& begin) {
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+// Heap bytes in use. Fall back to resident memory without glibc.
+static size_t usedBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    long pages = 0;
+    long resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    if (fscanf(file, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Timers which never fire during the bench.
+static void addPending(ManagerTimer& mt, size_t pending) {
+    for (size_t i = 0; i < pending; ++i) {
+        mt.postJobRunAfter(std::chrono::hours(1), noop);
+    }
+}
+
+static void benchAdd(ThreadPool* tp, size_t pending, size_t threads) {
+    const size_t jobs = 100000;
+    for (size_t n = 1; n <= threads; n *= 2) {
+        ManagerTimer mt(tp);
+        mt.init();
+        mt.start();
+        addPending(mt, pending);
+        std::vector<std::thread> producers;
+        auto begin = Clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            producers.emplace_back([&mt, jobs]() {
+                for (size_t j = 0; j < jobs; ++j) {
+                    mt.addJobRunAfter(std::chrono::hours(1), noop);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        double elapse = seconds(begin);
+        mt.stopAndJoin();
+        printf("  add      %8zu threads %14.0f adds/s\n",
+                n, static_cast<double>(n * jobs) / elapse);
+    }
+}
+
+static void benchLag(ThreadPool* tp, size_t pending) {
+    const size_t jobs = 2000;
+    ManagerTimer mt(tp);
+    mt.init();
+    mt.start();
+    addPending(mt, pending);
+    std::vector<std::atomic<long long>> lags(jobs);
+    std::atomic<size_t> fired(0);
+    auto base = Clock::now() + std::chrono::milliseconds(20);
+    for (size_t i = 0; i < jobs; ++i) {
+        // Spread over 200ms, 100us apart.
+        auto expiration = std::chrono::time_point_cast<Accuracy>(
+                base + std::chrono::microseconds(100 * i));
+        mt.postJobRunAt(expiration, [&lags, &fired, expiration, i]() {
+            lags[i] = std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - expiration).count();
+            ++fired;
+        });
+    }
+    while (fired < jobs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    mt.stopAndJoin();
+    std::vector<long long> sorted(lags.begin(), lags.end());
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        return sorted[std::min(sorted.size() - 1,
+                static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+    };
+    printf("  lag(us)  p50 %lld p90 %lld p99 %lld p999 %lld max %lld\n",
+            percentile(0.5), percentile(0.9), percentile(0.99),
+            percentile(0.999), sorted.back());
+}
+
+// Timers sharing the same deadline, time to fire all of them.
+static void benchBurst(ThreadPool* tp, size_t pending) {
+    ManagerTimer mt(tp);
+    mt.init();
+    mt.start();
+    std::atomic<size_t> fired(0);
+    // Leave time for adding.
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            Clock::now() + std::chrono::milliseconds(100) +
+            std::chrono::microseconds(10 * pending));
+    for (size_t i = 0; i < pending; ++i) {
+        mt.postJobRunAt(expiration, [&fired]() { ++fired; });
+    }
+    while (fired < pending) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto elapse = std::chrono::duration<double>(Clock::now() - expiration).count();
+    mt.stopAndJoin();
+    printf("  burst    %.1f ms to fire all\n", elapse * 1e3);
+}
+
+static void benchCancel(ThreadPool* tp, size_t pending) {
+    ManagerTimer mt(tp);
+    mt.init();
+    mt.start();
+    std::vector<ManagerTimer::TimerHandle> timers;
+    timers.reserve(pending);
+    for (size_t i = 0; i < pending; ++i) {
+        timers.push_back(mt.postJobRunAfter(std::chrono::hours(1), noop));
+    }
+    auto begin = Clock::now();
+    for (auto& timer : timers) {
+        timer->stopRepeat();
+    }
+    double stop_ns = seconds(begin) * 1e9 / static_cast<double>(pending);
+    begin = Clock::now();
+    for (auto& timer : timers) {
+        mt.cancel(timer);
+    }
+    double cancel_ns = seconds(begin) * 1e9 / static_cast<double>(pending);
+    mt.stopAndJoin();
+    printf("  cancel   %.1f ns/op, stopRepeat %.1f ns/op\n", cancel_ns, stop_ns);
+}
+
+static void benchExtend(ThreadPool* tp, size_t pending) {
+    const size_t touches = 1000000;
+    ManagerTimer mt(tp);
+    mt.init();
+    mt.start();
+    std::vector<ManagerTimer::TimerHandle> timers;
+    timers.reserve(pending);
+    for (size_t i = 0; i < pending; ++i) {
+        timers.push_back(mt.postJobRunAfter(std::chrono::hours(1), noop));
+    }
+    auto begin = Clock::now();
+    for (size_t i = 0; i < touches; ++i) {
+        mt.extendAfter(timers[i % pending], std::chrono::hours(2));
+    }
+    double extend_ns = seconds(begin) * 1e9 / static_cast<double>(touches);
+    begin = Clock::now();
+    for (size_t i = 0; i < touches; ++i) {
+        auto& timer = timers[i % pending];
+        mt.cancel(timer);
+        timer = mt.postJobRunAfter(std::chrono::hours(2), noop);
+    }
+    double readd_ns = seconds(begin) * 1e9 / static_cast<double>(touches);
+    mt.stopAndJoin();
+    printf("  extend   %.1f ns/op, cancel & add %.1f ns/op\n", extend_ns, readd_ns);
+}
+
+static void benchMemory(ThreadPool* tp, size_t pending) {
+    ManagerTimer mt(tp);
+    mt.init();
+    size_t before = usedBytes();
+    addPending(mt, pending);
+    size_t after = usedBytes();
+    printf("  memory   %.1f bytes/pending timer\n",
+            static_cast<double>(after - before) / static_cast<double>(pending));
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_pending = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t threads = argc > 2 ? strtoul(argv[2], nullptr, 10) :
+            std::max(4u, std::thread::hardware_concurrency());
+    ThreadPool pool(4);
+    for (ThreadPool* tp : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        for (size_t pending = 1000; pending <= max_pending; pending *= 10) {
+            printf("[%s] pending %zu\n", tp == nullptr ? "inline" : "pool", pending);
+            benchAdd(tp, pending, threads);
+            benchLag(tp, pending);
+            benchBurst(tp, pending);
+            benchCancel(tp, pending);
+            benchExtend(tp, pending);
+            benchMemory(tp, pending);
+        }
+    }
+    return 0;
+}
@@ -10,58 +10,29 @@
 #include <condition_variable>
 #include <functional>
 #include <future>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
-class Timer {
-    friend class ManagerTimer;
-    // Clock & Accuracy can be changed.
-    using Clock = std::chrono::steady_clock;
-    using Accuracy = Clock::duration;
-    using TimePoint = std::chrono::time_point<Clock, Accuracy>;
-    using CallBackFunc = std::function<void()>;
-public:
-    explicit Timer(const TimePoint& expiration) :
-            repeat_(false),
-            is_over_time_(false),
-            expiration_(expiration),
-            duration_(Accuracy::zero()),
-            handling_time_(Accuracy::max()) { }
-    explicit Timer(const Accuracy& duration) :
-            repeat_(true),
-            is_over_time_(false),
-            expiration_(std::chrono::time_point_cast<Accuracy>(
-                    Clock::now() + duration)),
-            duration_(duration),
-            handling_time_(Accuracy::max()) { }
-    Timer(const TimePoint& expiration, const Accuracy& duration) :
-            repeat_(true),
-            is_over_time_(false),
-            expiration_(expiration),
-            duration_(duration),
-            handling_time_(Accuracy::max()) { }
-    void stopRepeat() {
-        repeat_ = false;
-    }
-    bool isOverTime() const {
-        return is_over_time_;
-    }
-    TimePoint getHandlingTime() const {
-        return handling_time_;
-    }
-
-private:
-    std::atomic_bool repeat_;
-    std::atomic_bool is_over_time_;
-    TimePoint expiration_;
-    Accuracy duration_;
-    TimePoint handling_time_;
-    CallBackFunc cb_func_;
-};
+#include "timer.h"
+#include "timer_cron.h"
+#include "timer_executor.h"
+#include "timer_policy.h"
+#include "timer_pool.h"
+#include "timer_stats.h"
+#include "timer_storage.h"
+#include "timer_thread.h"
 
 class ThreadPool;
+struct RestoredJobs;
+
+namespace timer_detail {
+struct ArmTimer;
+}
 
 /*class TimerError : std::runtime_error {
 public:
@@ -69,30 +40,88 @@ public:
         std::runtime_error(msg) {}
 };*/
 
-class ManagerTimer {
+// Timer manager, policies decide at compile time how clock is read, which
+// storage holds timers & how callbacks are dispatched. (See timer_policy.h)
+// ManagerTimer is the runtime configurable one.
+template <typename ClockPolicy = SteadyClockPolicy,
+        typename StoragePolicy = TimerStorage,
+        typename DispatchPolicy = DynamicDispatch>
+class BasicManagerTimer {
+    static_assert(std::is_base_of<TimerStorage, StoragePolicy>::value,
+            "StoragePolicy should be a TimerStorage");
 public:
     using Clock = Timer::Clock;
     using Accuracy = Timer::Accuracy;
+    using TimerHandle = std::shared_ptr<Timer>;
+    // How system timer notify the loop.
+    // PosixTimer: timer_create with SIGEV_THREAD, notify loop by condition variable.
+    // TimerFd: timerfd & epoll, loop block in epoll_wait directly. (Linux only)
+    enum class AlarmType {
+        PosixTimer,
+        TimerFd
+    };
 private:
     using TimePoint = Timer::TimePoint;
-    using TimerPtr = std::shared_ptr<Timer>;
-    using TimerMap = std::multimap<TimePoint, TimerPtr>;
+    using TimerPtr = TimerHandle;
     using Seconds = std::chrono::seconds;
     using NanoSec = std::chrono::nanoseconds;
-    const long NanoSecPerSec = 1000000000;
 public:
-    explicit ManagerTimer(ThreadPool* thread_pool = nullptr) :
+    explicit BasicManagerTimer(ThreadPool* thread_pool = nullptr) :
                      init_(false),
                      running_(false),
+                     alarm_type_(AlarmType::PosixTimer),
                      timer_id_(nullptr),
+                     timer_fd_(-1),
+                     epoll_fd_(-1),
+                     event_fd_(-1),
+                     node_pool_(std::make_shared<TimerNodePool>()),
+                     storage_(StorageMaker<StoragePolicy>::make(
+                             std::chrono::time_point_cast<Accuracy>(ClockPolicy::now()))),
+                     alarm_time_(TimePoint::max()),
                      thread_pool_(thread_pool),
-                     over_time_(Accuracy::max()) {
-        now_time_ = std::chrono::time_point_cast<Accuracy>(Clock::now());
+                     executor_(nullptr),
+                     running_jobs_(0),
+                     max_in_flight_(0),
+                     lock_free_(false),
+                     submit_head_(nullptr),
+                     cancel_head_(nullptr),
+                     group_cancel_head_(nullptr),
+                     sleep_deadline_(TimePoint::max().time_since_epoch().count()),
+                     alarmed_(false),
+                     over_time_(Accuracy::max()),
+                     default_slack_(Accuracy::zero()),
+                     spin_window_(Accuracy::zero()),
+                     spin_cpu_(-1),
+                     spin_until_(TimePoint::max().time_since_epoch().count()),
+                     wakeups_(0),
+                     wakeups_saved_(0),
+                     rearms_(0),
+                     fired_(0),
+                     over_time_drops_(0),
+                     extends_(0),
+                     overload_drops_(0),
+                     overload_inline_(0),
+                     overload_blocks_(0),
+                     pending_(0),
+                     persistent_head_(nullptr),
+                     persistent_tail_(nullptr),
+                     snapshot_stamp_(0) {
+        // Calibration of clock is not paid by the first job added.
+        ClockPolicy::init();
+        now_time_ = std::chrono::time_point_cast<Accuracy>(ClockPolicy::now());
     }
-    ManagerTimer(const ManagerTimer&) = delete;
-    ManagerTimer& operator= (const ManagerTimer&) = delete;
-    ~ManagerTimer();
+    BasicManagerTimer(const BasicManagerTimer&) = delete;
+    BasicManagerTimer& operator= (const BasicManagerTimer&) = delete;
+    // Wait for callbacks queued in thread pool (executor). Destroy manager
+    // before the pool (executor), or it waits forever for dropped jobs.
+    ~BasicManagerTimer();
 
+    // Must be called before init().
+    bool setAlarmType(AlarmType type);
+    // Placement of loop thread, applied by start().
+    void setThreadOptions(const ThreadOptions& options) {
+        loop_options_ = options;
+    }
     bool init(char* err = nullptr);
     bool start(char* err = nullptr);
     void stop() {
@@ -100,26 +129,187 @@ public:
     }
     void stopAndJoin();
     void alarm();
+    // For AlarmType::TimerFd only.
+    // Without start(), add getFd() to your own epoll (readable when timer
+    // is expired) and call pollOnce() in your reactor thread.
+    int getFd() const {
+        return epoll_fd_;
+    }
+    // Wait at most timeout_ms (-1 is forever, 0 is not block) then handle
+    // expired timers. Return the count of expired timers, -1 on error.
+    // Can't be called with start() at the same time.
+    int pollOnce(int timeout_ms = 0);
 
     void setThreadPool(ThreadPool* tp) {
         thread_pool_ = tp;
     }
+    // Dispatch callbacks to executor (e.g. WorkStealingExecutor) without
+    // future. Used instead of thread pool if both are set. Executor must
+    // outlive manager.
+    void setExecutor(TimerExecutor* executor) {
+        executor_ = executor;
+    }
+    // At most 'max' callbacks queued or running in thread pool (executor),
+    // 0 is unlimited. (Default) Expired callbacks over it follow their
+    // TimerOptions::setOverload() policy.
+    void setMaxInFlight(size_t max) {
+        max_in_flight_ = max;
+    }
     template <typename A>
     void setOverTime(const A& duration) {
         over_time_ = std::chrono::duration_cast<Accuracy>(duration);
     }
+    // Slack of jobs without TimerOptions::setSlack(). Jobs whose windows
+    // [expiration, expiration + slack] overlap share one wakeup.
+    template <typename A>
+    void setDefaultSlack(const A& slack) {
+        default_slack_ = std::chrono::duration_cast<Accuracy>(slack);
+    }
+    // Count of wakeups saved by firing expirations before their deadline,
+    // with an earlier one.
+    uint64_t getWakeupsSaved() const {
+        return wakeups_saved_;
+    }
+    // Snapshot of counters & latency histograms.
+    TimerStats stats() const;
+
+    // Persistent jobs are saved by snapshot() and loaded by restore(),
+    // callback is registered by id and called with a small argument blob.
+    using PersistentCallback = std::function<void(const char* arg, size_t size)>;
+    static const size_t PersistentArgSize = 36;
+    // Must be done before adding persistent jobs or restore(), not thread
+    // safe with them.
+    bool registerCallback(uint32_t id, PersistentCallback func);
+    // Return nullptr if id is not registered or arg is bigger than
+    // PersistentArgSize.
+    TimerPtr addPersistentJobRunAt(const TimePoint& expiration,
+            uint32_t id, const void* arg, size_t size);
+    template <typename Rep, typename Per>
+    TimerPtr addPersistentJobRunAfter(const std::chrono::duration<Rep, Per>& duration,
+            uint32_t id, const void* arg, size_t size);
+    template <typename Rep, typename Per>
+    TimerPtr addPersistentJobRunEvery(const std::chrono::duration<Rep, Per>& duration,
+            uint32_t id, const void* arg, size_t size);
+    TimerPtr addPersistentJob(const TimerOptions& options,
+            const TimePoint& expiration, const Accuracy& period,
+            uint32_t id, const void* arg, size_t size);
+    // Write pending persistent jobs to a memory mapped file (path.tmp, then
+    // renamed to path). Jobs being run are not saved, take it after stop.
+    // Lock is held for SnapshotChunk jobs at a time, jobs added while it
+    // runs may not be saved.
+    // Slack, overload policy & group are not saved, restored jobs get the
+    // manager default slack, OverloadPolicy::Block and no group.
+    // In lock free submit mode it can only be taken after stopAndJoin().
+    bool snapshot(const char* path, char* err = nullptr);
+    // Load jobs saved by snapshot(). Records are checked & kept in memory,
+    // loop builds the timers when they are due, at most RestoreBatch per
+    // wakeup. Expirations passed while process was down go through over
+    // time & missed tick policy. Callbacks of all jobs in file must be
+    // registered. Fails if jobs of the last restore are not all due yet.
+    bool restore(const char* path, char* err = nullptr);
+    static const size_t SnapshotChunk = 4096;
+    static const size_t RestoreBatch = 4096;
+    // High precision mode. System timer wakes loop 'spin_window' before
+    // the next expiration, then loop busy polls clock until it. Loop
+    // thread is pinned to 'cpu' if it's not -1 (Linux only).
+    // Must be called before init().
+    template <typename A>
+    bool setPrecisionMode(const A& spin_window, int cpu = -1) {
+        if (init_) {
+            return false;
+        }
+        spin_window_ = std::chrono::duration_cast<Accuracy>(spin_window);
+        spin_cpu_ = cpu;
+        return true;
+    }
+    // Use hierarchical timing wheel instead of map to store timers.
+    // Insert & expire in O(1), timer may be late at most one tick.
+    // Must be called before any job added. Only with storage policy which
+    // can hold a wheel. (TimerStorage or TimingWheelStorage)
+    static constexpr bool TimingWheelCapable =
+            std::is_base_of<StoragePolicy, TimingWheelStorage>::value;
+    template <typename A>
+    bool setTimingWheel(const A& tick, unsigned int levels = 4);
+    // Producers push timers into a lock free queue instead of locking
+    // storage, loop thread drain the queue on every wake up and own the
+    // storage alone. Loop is woken only when new timer is earlier than
+    // its alarm. Must be called before init() & any job added.
+    bool setLockFreeSubmit(bool enable);
+    // Remove a pending timer and release its callback & arguments at once.
+    // Future of the job get std::future_error (broken_promise).
+    // Return false if timer is not pending (running or finished),
+    // a running repeat timer will not repeat any more.
+    // In lock free submit mode, timer is removed by loop thread later,
+    // return true if cancel request is queued.
+    bool cancel(const TimerHandle& timer);
+    // Remove all pending timers of group (see TimerOptions::setGroup) in
+    // time of group size, running repeat timers of group don't repeat.
+    // Jobs added to group later are not affected.
+    // Return count of timers removed. In lock free submit mode, they are
+    // removed by loop thread later, return count pending at the call.
+    size_t cancelGroup(const std::shared_ptr<TimerGroup>& group);
+    // Push expiration of a pending timer later (e.g. idle timeout on every
+    // packet). Only an atomic store, timer is moved when its old expiration
+    // comes. Expiration earlier than the current one is ignored (timer
+    // still fires at the old one), use cancel & add for that.
+    // A repeat timer goes on with its period from the new expiration.
+    // Return false if timer is not pending (fired, running or cancelled).
+    bool extend(const TimerHandle& timer, const TimePoint& expiration);
+    template <typename Rep, typename Per>
+    bool extendAfter(const TimerHandle& timer, const std::chrono::duration<Rep, Per>& duration) {
+        return extend(timer, std::chrono::time_point_cast<Accuracy>(
+                ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration)));
+    }
+    // Collect jobs, then add all of them by schedule() under one lock,
+    // system timer is re-armed at most once.
+    class ScheduleBatch {
+        friend class BasicManagerTimer;
+    public:
+        ScheduleBatch() = default;
+        // Allocate timers from node pool of mt.
+        explicit ScheduleBatch(const BasicManagerTimer& mt) : pool_(mt.node_pool_) { }
+        template <typename Func, typename... Args>
+        auto addJobRunAt(const TimePoint& expiration,
+                Func&& cb_func, Args&&... args)
+                -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+        template <typename Rep, typename Per, typename Func, typename... Args>
+        auto addJobRunAfter(const std::chrono::duration<Rep, Per>& duration,
+                Func&& cb_func, Args&&... args)
+                -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+        template <typename Rep, typename Per, typename Func, typename... Args>
+        TimerPtr addJobRunEvery(const std::chrono::duration<Rep, Per>& duration,
+                Func&& cb_func, Args&&... args);
+        void reserve(size_t size) {
+            timers_.reserve(size);
+        }
+        size_t size() const {
+            return timers_.size();
+        }
+
+    private:
+        std::shared_ptr<TimerNodePool> pool_;
+        std::vector<TimerPtr> timers_;
+    };
+    // Add all jobs of batch, batch is empty after.
+    // Return handles of every job in adding order.
+    std::vector<TimerHandle> schedule(ScheduleBatch& batch);
     // Run at time point.
     template <typename Func, typename... Args>
-    auto addJobRunAt(const ManagerTimer::TimePoint& expiration,
+    auto addJobRunAt(const TimePoint& expiration,
             Func&& cb_func, Args&&... args)
             -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
     template <typename C, typename A, typename Func, typename... Args>
     auto addJobRunAt(const std::chrono::time_point<C, A>& expiration,
             Func&& cb_func, Args&&... args)
             ->std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+    template <typename Func, typename... Args>
+    auto addJobRunAt(const TimerOptions& options,
+            const TimePoint& expiration,
+            Func&& cb_func, Args&&... args)
+            -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
     // Run After time duration.
     template <typename Func, typename... Args>
-    auto addJobRunAfter(const ManagerTimer::Accuracy& duration,
+    auto addJobRunAfter(const Accuracy& duration,
             Func&& cb_func, Args&&... args)
             -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
     template <typename Func, typename... Args>
@@ -130,9 +320,30 @@ public:
     auto addJobRunAfter(const std::chrono::duration<Rep, Per>& duration,
             Func&& cb_func, Args&&... args)
             -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+    template <typename Rep, typename Per, typename Func, typename... Args>
+    auto addJobRunAfter(const TimerOptions& options,
+            const std::chrono::duration<Rep, Per>& duration,
+            Func&& cb_func, Args&&... args)
+            -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+    // Run at time point / after time duration without future.
+    // Timer node & small callback don't allocate after node pool is warm.
+    template <typename Func, typename... Args>
+    TimerPtr postJobRunAt(const TimePoint& expiration,
+            Func&& cb_func, Args&&... args);
+    template <typename Rep, typename Per, typename Func, typename... Args>
+    TimerPtr postJobRunAfter(const std::chrono::duration<Rep, Per>& duration,
+            Func&& cb_func, Args&&... args);
+    template <typename Func, typename... Args>
+    TimerPtr postJobRunAt(const TimerOptions& options,
+            const TimePoint& expiration,
+            Func&& cb_func, Args&&... args);
+    template <typename Rep, typename Per, typename Func, typename... Args>
+    TimerPtr postJobRunAfter(const TimerOptions& options,
+            const std::chrono::duration<Rep, Per>& duration,
+            Func&& cb_func, Args&&... args);
     // Run Every time duration.
     template <typename Func, typename... Args>
-    TimerPtr addJobRunEvery(const ManagerTimer::Accuracy& duration,
+    TimerPtr addJobRunEvery(const Accuracy& duration,
             Func&& cb_func, Args&&... args);
     template <typename Func, typename... Args>
     TimerPtr addJobRunEvery(unsigned long int seconds,
@@ -140,7 +351,21 @@ public:
     template<typename Rep, typename Per, typename Func, typename... Args>
     TimerPtr addJobRunEvery(const std::chrono::duration<Rep, Per>& duration,
             Func&& cb_func, Args&&... args);
-    // Run at every time point of day/hour/minute.
+    template<typename Rep, typename Per, typename Func, typename... Args>
+    TimerPtr addJobRunEvery(const TimerOptions& options,
+            const std::chrono::duration<Rep, Per>& duration,
+            Func&& cb_func, Args&&... args);
+    // Run at every time matching cron expression (see CronSchedule) in
+    // local time zone. Missed times are skipped, missed tick policy is
+    // not used. Return nullptr if expression is invalid or never fires.
+    template <typename Func, typename... Args>
+    TimerPtr addJobCron(const std::string& expression, Func&& cb_func, Args&&... args);
+    // Schedule can be shared by many jobs and use any time zone.
+    template <typename Func, typename... Args>
+    TimerPtr addJobCron(const TimerOptions& options,
+            const std::shared_ptr<const CronSchedule>& schedule,
+            Func&& cb_func, Args&&... args);
+    // Run at every time point of day/hour/minute. (Cron in local time zone)
     template <typename Func, typename... Args>
     TimerPtr addJobRepeatAtDay(uint hour, uint min, uint sec,
             Func&& cb_func, Args&&... args);
@@ -151,205 +376,536 @@ public:
     TimerPtr addJobRepeatAtMinute(uint sec, Func&& cb_func, Args&&... args);
 
 private:
-    void loop();
-    void repeatFunc(const TimerPtr& timer);
-    void setNewAlarm(const TimePoint& expiration);
+    // Awaitables publish the timer before it's added.
+    friend struct timer_detail::ArmTimer;
+    using PoolPtr = std::shared_ptr<TimerNodePool>;
     template <typename Func, typename... Args>
-    TimerPtr addJobRepeatAt(const std::chrono::system_clock::time_point& alarm_time,
-            const std::chrono::system_clock::duration& duration,
+    static auto makeOnceTimer(const PoolPtr& pool, const TimePoint& expiration,
+            Func&& cb_func, Args&&... args)
+            -> std::pair<TimerPtr, std::future<typename std::result_of<Func(Args...)>::type>>;
+    template <typename Func, typename... Args>
+    static TimerPtr makePostTimer(const PoolPtr& pool, const TimePoint& expiration,
             Func&& cb_func, Args&&... args);
+    template <typename Func, typename... Args>
+    static TimerPtr makeRepeatTimer(const PoolPtr& pool, const TimePoint& expiration,
+            const Accuracy& duration, Func&& cb_func, Args&&... args);
+
+    static void applyOptions(Timer* timer, const TimerOptions& options);
+    // Put popped timer back at its extended expiration. Lock held.
+    bool moveExtended(Timer* timer);
+    // Timer is added back to storage, extend() works again.
+    void unmarkPopped(Timer* timer);
+    void loop();
+    bool initTimerFd(char* err);
+    size_t handleExpired(const TimePoint& now);
+    void addTimer(const TimerPtr& timer);
+    // Return false if timer is dropped as its group is cancelled, its
+    // reference is moved to dropped, callback is destroyed by caller out
+    // of lock.
+    bool insertTimer(const TimerPtr& timer, std::vector<TimerPtr>& dropped);
+    // Links of pending timer: its group & persistent job list.
+    bool linkTimer(Timer* timer);
+    void unlinkTimer(Timer* timer);
+    void linkPersistent(Timer* timer);
+    void unlinkPersistent(Timer* timer);
+    TimerPtr makePersistentTimer(const TimePoint& expiration, const Accuracy& period,
+            const PersistentCallback* func, uint32_t id, const void* arg, size_t size);
+    // Build restored jobs due at now into storage. Lock held.
+    void loadRestored(const TimePoint& now);
+    // Alarm needed by restored jobs not loaded yet. Lock held.
+    TimePoint restoredDeadline() const;
+    // Wake sleeping loop if earliest is before its alarm. (Lock free)
+    void wakeIfEarlier(const TimePoint& earliest);
+    // Erase pending timers of group, their references are moved to erased.
+    void eraseGroup(TimerGroup* group, std::vector<TimerPtr>& erased);
+    bool repeatFunc(const TimerPtr& timer, std::vector<TimerPtr>& dropped);
+    bool nextRepeat(const TimerPtr& timer);
+    bool nextCron(Timer* timer);
+    void submit(Timer* first, Timer* last, TimePoint earliest);
+    // Timers cancelled or dropped are moved to dropped. (See insertTimer)
+    void drainSubmitted(std::vector<TimerPtr>& dropped);
+    // Destroy callbacks of dropped timers, lock not held.
+    static void releaseDropped(std::vector<TimerPtr>& dropped);
+    void wakeUp();
+    void finishRepeat(const TimerPtr& timer);
+    void setNewAlarm(const TimePoint& expiration);
+    TimePoint spinToAlarm();
+    void runCallback(Timer::CallBackFunc& cb_func);
+    // Job in thread pool (executor) is finished.
+    void finishJob();
+    // Block loop until in flight callbacks are under limit.
+    void waitInFlight();
+    void flushDispatch();
+    void recordQueueWait(const Clock::time_point& enqueue_time, TimerPriority priority);
+    TimePoint alarmTimeOf(const Timer* timer) const;
 
     static void alarmFunction(union sigval val);
 
+    // One shot callback dispatched to thread pool.
+    struct PoolTask {
+        BasicManagerTimer* manager;
+        Timer::CallBackFunc cb_func;
+        Clock::time_point enqueue_time;
+        TimerPriority priority;
+        void operator()() {
+            manager->recordQueueWait(enqueue_time, priority);
+            manager->runCallback(cb_func);
+            manager->finishJob();
+        }
+    };
+
+    // Bound arguments live in callback but not in shared state of future,
+    // so they can be released when timer is cancelled.
+    template <typename R, typename Bound>
+    struct BoundTask {
+        std::packaged_task<R(Bound&)> task;
+        Bound func;
+        void operator()() {
+            task(func);
+        }
+    };
+
     std::atomic_bool init_;
     std::atomic_bool running_;
+    AlarmType alarm_type_;
     timer_t timer_id_;
+    int timer_fd_;
+    int epoll_fd_;
+    int event_fd_; // Wake up epoll_wait when stop
+    std::shared_ptr<TimerNodePool> node_pool_;
     std::mutex map_mutex_;
-    TimerMap timer_map_; // // Project by map_mutex_
+    std::unique_ptr<StoragePolicy> storage_; // Protect by map_mutex_
+    TimePoint alarm_time_; // Protect by map_mutex_
     std::thread loop_thread_;
+    ThreadOptions loop_options_;
     ThreadPool* thread_pool_;
+    TimerExecutor* executor_;
+    std::atomic<size_t> running_jobs_; // Jobs in thread pool
+    // Admission control of running_jobs_.
+    size_t max_in_flight_;
+    std::mutex in_flight_mutex_;
+    std::condition_variable in_flight_cv_;
+
+    // Lock free submit mode.
+    bool lock_free_;
+    std::atomic<Timer*> submit_head_; // Linked by Timer::submit_next_
+    std::atomic<Timer*> cancel_head_; // Linked by Timer::cancel_next_
+    std::atomic<TimerGroup*> group_cancel_head_; // Linked by TimerGroup::cancel_next_
+    // Alarm of sleeping loop, TimePoint::min() while loop is awake.
+    std::atomic<Accuracy::rep> sleep_deadline_;
 
     std::mutex loop_mutex_;
     std::condition_variable cv_;
+    bool alarmed_; // Protect by loop_mutex_
     TimePoint now_time_;
+    // Scratch of handleExpired(), used by loop thread only.
+    std::vector<Timer*> popped_;
+    std::vector<TimerPtr> expired_;
+    std::vector<TimerPtr> dropped_;
+    std::vector<Timer::CallBackFunc> dispatch_; // Batch to executor_, only used by loop thread
+    std::vector<TaskOrder> orders_; // Order of dispatch_
 
     Accuracy over_time_;
+    Accuracy default_slack_;
+
+    // High precision mode, spin_until_ is copy of alarm_time_ read by
+    // spinning loop.
+    Accuracy spin_window_;
+    int spin_cpu_;
+    std::atomic<Accuracy::rep> spin_until_;
+
+    // Statistics.
+    std::atomic<uint64_t> wakeups_;
+    std::atomic<uint64_t> wakeups_saved_;
+    std::atomic<uint64_t> rearms_;
+    std::atomic<uint64_t> fired_;
+    std::atomic<uint64_t> over_time_drops_;
+    std::atomic<uint64_t> extends_;
+    std::atomic<uint64_t> overload_drops_;
+    std::atomic<uint64_t> overload_inline_;
+    std::atomic<uint64_t> overload_blocks_;
+    std::atomic<size_t> pending_;
+    LatencyHistogram fire_lag_;
+    LatencyHistogram queue_wait_;
+    LatencyHistogram class_queue_wait_[TimerStats::PriorityNum];
+    LatencyHistogram run_time_;
+
+    // Registered callbacks of persistent jobs, value address is stable.
+    std::unordered_map<uint32_t, std::unique_ptr<PersistentCallback>> persistent_callbacks_;
+    // Pending persistent jobs, linked by Timer::persistent_next_. Protect
+    // by map_mutex_
+    Timer* persistent_head_;
+    Timer* persistent_tail_;
+    // Jobs of restore() not loaded yet. Protect by map_mutex_
+    std::shared_ptr<RestoredJobs> restored_;
+    std::mutex snapshot_mutex_; // One snapshot at a time
+    uint64_t snapshot_stamp_; // Protect by snapshot_mutex_
 };
 
+using ManagerTimer = BasicManagerTimer<>;
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename A>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::setTimingWheel(const A& tick, unsigned int levels) {
+    static_assert(TimingWheelCapable, "StoragePolicy can't hold a timing wheel");
+    auto tick_dur = std::chrono::duration_cast<Accuracy>(tick);
+    if (tick_dur <= Accuracy::zero() ||
+        levels == 0 || levels > TimingWheelStorage::MaxLevels) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(map_mutex_);
+    if (!storage_->empty()) {
+        return false;
+    }
+    storage_.reset(new TimingWheelStorage(tick_dur, levels,
+            std::chrono::time_point_cast<Accuracy>(ClockPolicy::now())));
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-auto ManagerTimer::addJobRunAt(
-        const ManagerTimer::TimePoint& expiration,
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::makeOnceTimer(
+        const PoolPtr& pool,
+        const TimePoint& expiration,
         Func&& cb_func, Args&&... args)
-        -> std::pair<ManagerTimer::TimerPtr,
+        -> std::pair<TimerPtr,
         std::future<typename std::result_of<Func(Args...)>::type>> {
-    std::shared_ptr<Timer> timer(new Timer(expiration));
+    auto timer = std::allocate_shared<Timer>(PoolAllocator<Timer>(pool), expiration);
     using return_type = typename std::result_of<Func(Args...)>::type;
-    auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...)
-    );
-    timer->cb_func_ = ([task](){ (*task)(); });
-    map_mutex_.lock();
-    auto iter = timer_map_.emplace(std::make_pair(timer->expiration_, timer));
-    if (iter == timer_map_.begin()) {
-        setNewAlarm(timer->expiration_);
-    }
-    map_mutex_.unlock();
-    return std::make_pair(timer, task->get_future());
+    auto bound = std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    using Bound = decltype(bound);
+    std::packaged_task<return_type(Bound&)> task(
+            [](Bound& func) { return func(); });
+    auto future = task.get_future();
+    timer->cb_func_ = BoundTask<return_type, Bound>{std::move(task), std::move(bound)};
+    return std::make_pair(std::move(timer), std::move(future));
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::makePostTimer(
+        const PoolPtr& pool,
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto timer = std::allocate_shared<Timer>(PoolAllocator<Timer>(pool), expiration);
+    timer->cb_func_ = std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    return timer;
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::makeRepeatTimer(
+        const PoolPtr& pool,
+        const TimePoint& expiration,
+        const Accuracy& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto timer = std::allocate_shared<Timer>(
+            PoolAllocator<Timer>(pool), expiration, duration);
+    timer->cb_func_ = std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::ScheduleBatch::addJobRunAt(
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args)
+        -> std::pair<TimerPtr,
+        std::future<typename std::result_of<Func(Args...)>::type>> {
+    auto pair = makeOnceTimer(pool_, expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    timers_.push_back(pair.first);
+    return pair;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::ScheduleBatch::addJobRunAfter(
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args)
+        -> std::pair<TimerPtr,
+        std::future<typename std::result_of<Func(Args...)>::type>> {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration));
+    return addJobRunAt(expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::ScheduleBatch::addJobRunEvery(
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto dur = std::chrono::duration_cast<Accuracy>(duration);
+    auto expiration = std::chrono::time_point_cast<Accuracy>(ClockPolicy::submit() + dur);
+    auto timer = makeRepeatTimer(pool_, expiration, dur,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    timers_.push_back(timer);
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAt(
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args)
+        -> std::pair<TimerPtr,
+        std::future<typename std::result_of<Func(Args...)>::type>> {
+    return addJobRunAt(TimerOptions(), expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAt(
+        const TimerOptions& options,
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args)
+        -> std::pair<TimerPtr,
+        std::future<typename std::result_of<Func(Args...)>::type>> {
+    auto pair = makeOnceTimer(node_pool_, expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    applyOptions(pair.first.get(), options);
+    addTimer(pair.first);
+    return pair;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename C, typename A, typename Func, typename... Args>
-auto ManagerTimer::addJobRunAt(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAt(
         const std::chrono::time_point<C, A>& expiration,
         Func&& cb_func, Args&&... args)
-        -> std::pair<ManagerTimer::TimerPtr,
+        -> std::pair<TimerPtr,
         std::future<typename std::result_of<Func(Args...)>::type>> {
     // If clock is not same. Use 'Clock::now + (expiration - C::now)'
     // If accuracy is not same, need cast.
-    auto exp = std::chrono::time_point_cast<ManagerTimer::Accuracy>(
-            Clock::now() + std::chrono::duration_cast<Clock::duration>(
+    auto exp = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Clock::duration>(
                     expiration - std::chrono::time_point_cast<A>(C::now())));
     return addJobRunAt(exp, cb_func, args...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template<typename Func, typename... Args>
-auto ManagerTimer::addJobRunAfter(
-        const ManagerTimer::Accuracy& duration,
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAfter(
+        const Accuracy& duration,
         Func&& cb_func, Args&&... args)
-        -> std::pair<ManagerTimer::TimerPtr,
+        -> std::pair<TimerPtr,
         std::future<typename std::result_of<Func(Args...)>::type>> {
-    auto expiration = std::chrono::time_point_cast<Accuracy>(Clock::now() + duration);
+    auto expiration = std::chrono::time_point_cast<Accuracy>(ClockPolicy::submit() + duration);
     return addJobRunAt(expiration, cb_func, args...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-auto ManagerTimer::addJobRunAfter(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAfter(
         unsigned long int seconds,
         Func&& cb_func, Args&&... args)
-        -> std::pair<ManagerTimer::TimerPtr,
+        -> std::pair<TimerPtr,
         std::future<typename std::result_of<Func(Args...)>::type>> {
-    return addJobRunAfter(ManagerTimer::Seconds(seconds), cb_func, args...);
+    return addJobRunAfter(Seconds(seconds), cb_func, args...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template<typename Rep, typename Per, typename Func, typename... Args>
-auto ManagerTimer::addJobRunAfter(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAfter(
         const std::chrono::duration<Rep, Per>& duration,
         Func&& cb_func, Args&&... args)
-        ->std::pair<ManagerTimer::TimerPtr,
+        ->std::pair<TimerPtr,
         std::future<typename std::result_of<Func(Args...)>::type>> {
     return addJobRunAfter(std::chrono::duration_cast<Accuracy>(duration), cb_func, args...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template<typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunAfter(
+        const TimerOptions& options,
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args)
+        ->std::pair<TimerPtr,
+        std::future<typename std::result_of<Func(Args...)>::type>> {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration));
+    return addJobRunAt(options, expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRunEvery(
-        const ManagerTimer::Accuracy& duration,
-        Func&& cb_func, Args&&... args) {
-    std::shared_ptr<Timer> timer(new Timer(duration));
-    timer->cb_func_ = std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...);
-    map_mutex_.lock();
-    auto iter = timer_map_.emplace(std::make_pair(timer->expiration_, timer));
-    if (iter == timer_map_.begin()) {
-        setNewAlarm(timer->expiration_);
-    }
-    map_mutex_.unlock();
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::postJobRunAt(
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    return postJobRunAt(TimerOptions(), expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::postJobRunAt(
+        const TimerOptions& options,
+        const TimePoint& expiration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto timer = makePostTimer(node_pool_, expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    applyOptions(timer.get(), options);
+    addTimer(timer);
     return timer;
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::postJobRunAfter(
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration));
+    return postJobRunAt(expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::postJobRunAfter(
+        const TimerOptions& options,
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration));
+    return postJobRunAt(options, expiration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRunEvery(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunEvery(
+        const Accuracy& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(ClockPolicy::submit() + duration);
+    auto timer = makeRepeatTimer(node_pool_, expiration, duration,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    addTimer(timer);
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunEvery(
         unsigned long int seconds,
-        Func&& cb_func, Args&&... args) {
-    return addJobRunEvery(ManagerTimer::Seconds(seconds), cb_func, args...);
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    return addJobRunEvery(Seconds(seconds), cb_func, args...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template<typename Rep, typename Per, typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRunEvery(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunEvery(
         const std::chrono::duration<Rep, Per>& duration,
-        Func&& cb_func, Args&&... args) {
+        Func&& cb_func, Args&&... args) -> TimerPtr {
     auto dur = std::chrono::duration_cast<Accuracy>(duration);
     return addJobRunEvery(dur, cb_func, args...);
 }
 
-// This function must ensure parameter is valid.
-// If not have this parameter, input -1.
-// sec can't be -1.
-static std::chrono::system_clock::time_point
-getAlarmTime(int hour, int min, int sec) {
-    auto c_time_t = std::chrono::system_clock::to_time_t(
-            std::chrono::system_clock::now());
-    struct tm calendar{};
-    if (nullptr == localtime_r(&c_time_t, &calendar)) {
-        return std::chrono::system_clock::time_point::min();
-    }
-    if (hour != -1) {
-        calendar.tm_hour = hour;
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template<typename Rep, typename Per, typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRunEvery(
+        const TimerOptions& options,
+        const std::chrono::duration<Rep, Per>& duration,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    auto dur = std::chrono::duration_cast<Accuracy>(duration);
+    auto expiration = std::chrono::time_point_cast<Accuracy>(ClockPolicy::submit() + dur);
+    auto timer = makeRepeatTimer(node_pool_, expiration, dur,
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    applyOptions(timer.get(), options);
+    addTimer(timer);
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addPersistentJobRunAfter(
+        const std::chrono::duration<Rep, Per>& duration,
+        uint32_t id, const void* arg, size_t size) -> TimerPtr {
+    auto expiration = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(duration));
+    return addPersistentJob(TimerOptions(), expiration, Accuracy::zero(), id, arg, size);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Rep, typename Per>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addPersistentJobRunEvery(
+        const std::chrono::duration<Rep, Per>& duration,
+        uint32_t id, const void* arg, size_t size) -> TimerPtr {
+    auto dur = std::chrono::duration_cast<Accuracy>(duration);
+    auto expiration = std::chrono::time_point_cast<Accuracy>(ClockPolicy::submit() + dur);
+    return addPersistentJob(TimerOptions(), expiration, dur, id, arg, size);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobCron(
+        const std::string& expression, Func&& cb_func, Args&&... args) -> TimerPtr {
+    return addJobCron(TimerOptions(), CronSchedule::parse(expression),
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+template <typename Func, typename... Args>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobCron(
+        const TimerOptions& options,
+        const std::shared_ptr<const CronSchedule>& schedule,
+        Func&& cb_func, Args&&... args) -> TimerPtr {
+    if (schedule == nullptr) {
+        return nullptr;
     }
-    if (min != -1) {
-        calendar.tm_min = min;
+    auto timer = makeRepeatTimer(node_pool_, TimePoint(), Accuracy::zero(),
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
+    timer->cron_ = std::make_shared<CronJob>(schedule);
+    if (!nextCron(timer.get())) {
+        return nullptr;
     }
-    calendar.tm_sec = sec;
-    c_time_t = mktime(&calendar);
-    return std::chrono::system_clock::from_time_t(c_time_t);
+    applyOptions(timer.get(), options);
+    addTimer(timer);
+    return timer;
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRepeatAtDay(
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRepeatAtDay(
         uint hour, uint min, uint sec,
-        Func&& cb_func, Args&&... args) {
+        Func&& cb_func, Args&&... args) -> TimerPtr {
     if (hour > 23 || min > 59 || sec > 59) {
         return nullptr;
     }
-    auto alarm_time = getAlarmTime(hour, min, sec);
-    if (alarm_time == std::chrono::system_clock::time_point::min()) {
-        return nullptr;
-    }
-    return addJobRepeatAt(alarm_time, std::chrono::hours(24), cb_func, args...);
+    return addJobCron(TimerOptions(), CronSchedule::at(static_cast<int>(hour),
+            static_cast<int>(min), static_cast<int>(sec)),
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRepeatAtHour(
-        uint min, uint sec, Func&& cb_func, Args&&... args) {
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRepeatAtHour(
+        uint min, uint sec, Func&& cb_func, Args&&... args) -> TimerPtr {
     if (min > 59 || sec > 59) {
         return nullptr;
     }
-    auto alarm_time = getAlarmTime(-1, min, sec);
-    if (alarm_time == std::chrono::system_clock::time_point::min()) {
-        return nullptr;
-    }
-    return addJobRepeatAt(alarm_time, std::chrono::hours(1), cb_func, args...);
+    return addJobCron(TimerOptions(), CronSchedule::at(-1, static_cast<int>(min),
+            static_cast<int>(sec)), std::forward<Func>(cb_func), std::forward<Args>(args)...);
 }
 
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
 template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRepeatAtMinute(
-        uint sec, Func&& cb_func, Args&&... args) {
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addJobRepeatAtMinute(
+        uint sec, Func&& cb_func, Args&&... args) -> TimerPtr {
     if (sec > 59) {
         return nullptr;
     }
-    auto alarm_time = getAlarmTime(-1, -1, sec);
-    if (alarm_time == std::chrono::system_clock::time_point::min()) {
-        return nullptr;
-    }
-    return addJobRepeatAt(alarm_time, std::chrono::minutes(1), cb_func, args...);
+    return addJobCron(TimerOptions(), CronSchedule::at(-1, -1, static_cast<int>(sec)),
+            std::forward<Func>(cb_func), std::forward<Args>(args)...);
 }
 
-template <typename Func, typename... Args>
-ManagerTimer::TimerPtr ManagerTimer::addJobRepeatAt(
-        const std::chrono::system_clock::time_point& alarm_time,
-        const std::chrono::system_clock::duration& duration,
-        Func&& cb_func, Args&&... args) {
-    using C = std::chrono::system_clock;
-    using A = std::chrono::system_clock::duration;
-    auto exp = std::chrono::time_point_cast<ManagerTimer::Accuracy>(
-            Clock::now() + std::chrono::duration_cast<Clock::duration>(
-                    alarm_time - std::chrono::time_point_cast<A>(C::now())));
-    std::shared_ptr<Timer> timer(new Timer(exp, duration));
-    timer->cb_func_ = std::bind(std::forward<Func>(cb_func), std::forward<Args>(args)...);
-    map_mutex_.lock();
-    auto iter = timer_map_.emplace(std::make_pair(timer->expiration_, timer));
-    if (iter == timer_map_.begin()) {
-        setNewAlarm(timer->expiration_);
-    }
-    map_mutex_.unlock();
-    return timer;
-}
+#include "manager_timer_inl.h"
+#include "timer_snapshot.h"
+
+// Default policies are compiled once in manager_timer.cpp.
+extern template class BasicManagerTimer<>;
 
 #endif //MANAGER_TIMER_H
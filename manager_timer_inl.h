@@ -0,0 +1,1033 @@
+#ifndef MANAGER_TIMER_INL_H
+#define MANAGER_TIMER_INL_H
+
+// Member definitions of BasicManagerTimer, included by manager_timer.h.
+
+#include <algorithm>
+#include <csignal>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include "ThreadPool.h"
+
+#include "manager_timer.h"
+
+// Hint CPU that this is a busy wait loop.
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::~BasicManagerTimer() {
+    stopAndJoin();
+    // Jobs in thread pool will add timer back or record stats.
+    {
+        std::unique_lock<std::mutex> lock(in_flight_mutex_);
+        in_flight_cv_.wait(lock, [this]() {
+            return running_jobs_ == 0;
+        });
+    }
+    if (alarm_type_ == AlarmType::PosixTimer) {
+        timer_delete(timer_id_);
+    }
+#ifdef __linux__
+    for (int fd : {timer_fd_, event_fd_, epoll_fd_}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+#endif
+    // Break the self reference of pending timers.
+    drainSubmitted(dropped_);
+    releaseDropped(dropped_);
+    Timer* timer;
+    while ((timer = storage_->popAny()) != nullptr) {
+        unlinkTimer(timer);
+        timer->pending_ref_.reset();
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::setAlarmType(AlarmType type) {
+    if (init_) {
+        return false;
+    }
+#ifndef __linux__
+    if (type == AlarmType::TimerFd) {
+        return false;
+    }
+#endif
+    alarm_type_ = type;
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::setLockFreeSubmit(bool enable) {
+    if (init_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(map_mutex_);
+    if (!storage_->empty() || submit_head_ != nullptr) {
+        return false;
+    }
+    lock_free_ = enable;
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::init(char *err) {
+    if (init_) {
+        return true;
+    }
+    if (alarm_type_ == AlarmType::TimerFd) {
+        return initTimerFd(err);
+    }
+    // Register alarm call back function.
+    struct sigevent evp{};
+    evp.sigev_notify = SIGEV_THREAD;
+    evp.sigev_value.sival_ptr = this;
+    evp._sigev_un._sigev_thread._function = &alarmFunction;
+    // Create system timer.
+    if (timer_create(CLOCK_MONOTONIC, &evp, &timer_id_) == -1) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Init timer failed. Errno: %d", errno);
+        }
+        return false;
+    }
+    init_ = true;
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::initTimerFd(char* err) {
+#ifdef __linux__
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    bool ok = timer_fd_ != -1 && event_fd_ != -1 && epoll_fd_ != -1;
+    for (int fd : {timer_fd_, event_fd_}) {
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        ok = ok && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+    if (!ok) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Init timerfd failed. Errno: %d", errno);
+        }
+        return false;
+    }
+    init_ = true;
+    return true;
+#else
+    if (err != nullptr) {
+        snprintf(err, 1024, "Timerfd is not supported.");
+    }
+    return false;
+#endif
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::start(char* err) {
+    if (!init_) {
+        return false;
+    }
+    running_ = true;
+    // New thread.
+    try {
+        loop_thread_ = std::thread(&BasicManagerTimer::loop, this);
+    } catch (std::exception& e) {
+        snprintf(err, 1024,
+                "Create new thread failed. Error: %s", e.what());
+        return false;
+    }
+    ThreadOptions options = loop_options_;
+    if (spin_cpu_ >= 0 && options.cpus.empty() && options.numa_node < 0) {
+        options.cpus.push_back(spin_cpu_);
+    }
+    if (!applyThreadOptions(loop_thread_.native_handle(), options, -1, err)) {
+        stopAndJoin();
+        return false;
+    }
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::stopAndJoin() {
+    {
+        std::lock_guard<std::mutex> lock(loop_mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+#ifdef __linux__
+    if (event_fd_ != -1) {
+        uint64_t value = 1;
+        ssize_t ret = write(event_fd_, &value, sizeof(value));
+        (void)ret;
+    }
+#endif
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::alarm() {
+    {
+        // Loop may be busy, keep the alarm until it waits again.
+        std::lock_guard<std::mutex> lock(loop_mutex_);
+        auto now_time = std::chrono::time_point_cast<Accuracy>(ClockPolicy::wakeup());
+        if (now_time > now_time_) {
+            now_time_ = now_time;
+        }
+        alarmed_ = true;
+    }
+    cv_.notify_one();
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::loop() {
+    if (alarm_type_ == AlarmType::TimerFd) {
+        // Arm for jobs added before start.
+        now_time_ = std::chrono::time_point_cast<Accuracy>(ClockPolicy::wakeup());
+        handleExpired(now_time_);
+        while (running_) {
+            pollOnce(3600 * 1000);
+        }
+        return;
+    }
+    while (running_) {
+        std::unique_lock<std::mutex> lk(loop_mutex_);
+        if (!running_) {
+            break;
+        }
+        // Wait for notify or 1 hour.
+        cv_.wait_for(lk, Seconds(3600), [this]() {
+            return alarmed_ || !running_;
+        });
+        alarmed_ = false;
+        auto now = now_time_;
+        // Callbacks are run out of loop_mutex_, alarm() never waits them.
+        lk.unlock();
+        if (spin_window_ > Accuracy::zero()) {
+            now = spinToAlarm();
+        }
+        handleExpired(now);
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+int BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::pollOnce(int timeout_ms) {
+#ifdef __linux__
+    if (epoll_fd_ == -1) {
+        return -1;
+    }
+    struct epoll_event events[2];
+    int num = epoll_wait(epoll_fd_, events, 2, timeout_ms);
+    if (num == -1 && errno != EINTR) {
+        return -1;
+    }
+    for (int i = 0; i < num; ++i) {
+        // Both timerfd & eventfd are drained by reading 8 bytes.
+        uint64_t value;
+        ssize_t ret = read(events[i].data.fd, &value, sizeof(value));
+        (void)ret;
+    }
+    if (spin_window_ > Accuracy::zero()) {
+        now_time_ = spinToAlarm();
+    } else {
+        now_time_ = std::chrono::time_point_cast<Accuracy>(ClockPolicy::wakeup());
+    }
+    return static_cast<int>(handleExpired(now_time_));
+#else
+    (void)timeout_ms;
+    return -1;
+#endif
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+size_t BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::handleExpired(
+        const TimePoint& now) {
+    if (lock_free_) {
+        // Loop is awake, producers needn't wake it up.
+        sleep_deadline_ = TimePoint::min().time_since_epoch().count();
+        drainSubmitted(dropped_);
+        releaseDropped(dropped_);
+    }
+    ++wakeups_;
+    // Phase 1: take all expired timers out in one critical section.
+    bool prioritized = false;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        if (restored_ != nullptr) {
+            loadRestored(now);
+        }
+        storage_->popAllExpired(now, popped_);
+        // Alarm of this wakeup, later if loop woke late.
+        TimePoint fired_at = std::max(alarm_time_, now);
+        TimePoint last_expiration = TimePoint::min();
+        for (Timer* timer : popped_) {
+            if (moveExtended(timer)) {
+                continue;
+            }
+            unlinkTimer(timer);
+            --pending_;
+            prioritized = prioritized || timer->priority_ != TimerPriority::Normal;
+            // Timer would need its own wakeup at its deadline, if that's
+            // later than this one. Counted once per expiration, before
+            // priority sort.
+            if (timer->expiration_ != last_expiration && timer->deadline() > fired_at) {
+                ++wakeups_saved_;
+                last_expiration = timer->expiration_;
+            }
+            expired_.push_back(std::move(timer->pending_ref_));
+        }
+    }
+    popped_.clear();
+    if (prioritized) {
+        // Dispatch by priority class, then by expiration.
+        std::sort(expired_.begin(), expired_.end(),
+                [](const TimerPtr& a, const TimerPtr& b) {
+            return a->priority_ != b->priority_ ?
+                    a->priority_ < b->priority_ : a->expiration_ < b->expiration_;
+        });
+    }
+    // Phase 2: dispatch without lock. Timers left in expired_ are repeat
+    // timers to be added back.
+    size_t count = 0;
+    auto enqueue_time = ClockPolicy::now();
+    for (auto& timer : expired_) {
+        if (timer->cancelled_) {
+            // Cancelled after drainSubmitted(), cancel() already returned
+            // true. (Lock free submit mode)
+            timer->cb_func_ = nullptr;
+            timer = nullptr;
+            continue;
+        }
+        ++count;
+        // Check if the timer is over.
+        bool over_time = ((now - timer->expiration_) > over_time_);
+        bool run_inline = !(DispatchPolicy::Executor && executor_ != nullptr) &&
+                !(DispatchPolicy::Pool && thread_pool_ != nullptr);
+        bool shed = false;
+        if (!over_time && !run_inline && max_in_flight_ != 0 &&
+            running_jobs_ >= max_in_flight_) {
+            switch (timer->overload_) {
+            case OverloadPolicy::Block:
+                waitInFlight();
+                break;
+            case OverloadPolicy::Drop:
+                over_time = true;
+                shed = true;
+                ++overload_drops_;
+                break;
+            case OverloadPolicy::Inline:
+                run_inline = true;
+                ++overload_inline_;
+                break;
+            }
+        }
+        timer->is_over_time_ = over_time;
+        if (over_time) {
+            if (!shed) {
+                ++over_time_drops_;
+            }
+        } else {
+            ++fired_;
+            if (now > timer->expiration_) {
+                fire_lag_.record(static_cast<uint64_t>(std::chrono::duration_cast<NanoSec>(
+                        now - timer->expiration_).count()));
+            } else {
+                fire_lag_.record(0);
+            }
+            timer->handling_time_ = now;
+            if (run_inline) {
+                runCallback(timer->cb_func_);
+            } else if (DispatchPolicy::Executor && executor_ != nullptr) {
+                // Callback is run in place, task fits in Callback inline.
+                // Tasks are handed to executor in one batch.
+                ++running_jobs_;
+                dispatch_.emplace_back([this, timer, enqueue_time]() {
+                    recordQueueWait(enqueue_time, timer->priority_);
+                    runCallback(timer->cb_func_);
+                    if (timer->periodic()) {
+                        finishRepeat(timer);
+                    } else {
+                        timer->cb_func_ = nullptr;
+                    }
+                    finishJob();
+                });
+                orders_.push_back(TaskOrder{timer->priority_, timer->expiration_});
+                timer = nullptr;
+                continue;
+            } else if (timer->repeat_) {
+                // Repeat timer is added back after callback is finished,
+                // callback is never run by two threads at the same time.
+                ++running_jobs_;
+                thread_pool_->enqueue([this, timer, enqueue_time]() {
+                    recordQueueWait(enqueue_time, timer->priority_);
+                    runCallback(timer->cb_func_);
+                    finishRepeat(timer);
+                    finishJob();
+                });
+                timer = nullptr;
+                continue;
+            } else {
+                ++running_jobs_;
+                thread_pool_->enqueue(PoolTask{this, std::move(timer->cb_func_),
+                        enqueue_time, timer->priority_});
+            }
+        }
+        if (!nextRepeat(timer)) {
+            timer = nullptr;
+        }
+    }
+    flushDispatch();
+    {
+        // Add repeat timers back & set new time alarm in one critical section.
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        for (auto& timer : expired_) {
+            if (timer != nullptr) {
+                insertTimer(timer, dropped_);
+            }
+        }
+        // Only references of pending timers are left, keep capacity.
+        expired_.clear();
+        auto alarm_time = restoredDeadline();
+        if (!storage_->empty()) {
+            alarm_time = std::min(alarm_time, storage_->nextDeadline());
+        }
+        if (alarm_time != TimePoint::max()) {
+            setNewAlarm(alarm_time);
+        } else {
+            alarm_time_ = TimePoint::max();
+            spin_until_ = alarm_time_.time_since_epoch().count();
+        }
+        while (lock_free_) {
+            // Publish alarm then check queue again. Producer either sees the
+            // alarm and wakes loop up, or its timer is drained here.
+            sleep_deadline_ = alarm_time_.time_since_epoch().count();
+            if (submit_head_ == nullptr) {
+                break;
+            }
+            sleep_deadline_ = TimePoint::min().time_since_epoch().count();
+            drainSubmitted(dropped_);
+            if (!storage_->empty() && storage_->nextDeadline() < alarm_time_) {
+                setNewAlarm(storage_->nextDeadline());
+            }
+        }
+    }
+    releaseDropped(dropped_);
+    return count;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::extend(
+        const TimerHandle& timer, const TimePoint& expiration) {
+    if (timer == nullptr || timer->manager_ != this || timer->cancelled_) {
+        return false;
+    }
+    auto extended = timer->extended_.load(std::memory_order_relaxed);
+    do {
+        if (extended == Timer::Popped) {
+            return false;
+        }
+    } while (!timer->extended_.compare_exchange_weak(extended,
+            expiration.time_since_epoch().count(), std::memory_order_relaxed));
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::moveExtended(Timer* timer) {
+    // Either move it or mark it popped, extend() racing with it sees one.
+    const int64_t not_extended = Timer::NotExtended;
+    const int64_t popped = Timer::Popped;
+    auto extended = timer->extended_.load(std::memory_order_relaxed);
+    bool move;
+    do {
+        move = extended > timer->expiration_.time_since_epoch().count();
+    } while (!timer->extended_.compare_exchange_weak(extended,
+            move ? not_extended : popped, std::memory_order_relaxed));
+    if (!move) {
+        return false;
+    }
+    timer->expiration_ = TimePoint(Accuracy(extended));
+    storage_->insert(timer);
+    ++extends_;
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::unmarkPopped(Timer* timer) {
+    // Extension made before it's popped is kept.
+    int64_t popped = Timer::Popped;
+    timer->extended_.compare_exchange_strong(popped, Timer::NotExtended,
+            std::memory_order_relaxed);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::applyOptions(
+        Timer* timer, const TimerOptions& options) {
+    timer->slack_ = options.slack_;
+    timer->missed_tick_ = options.missed_tick_;
+    timer->max_catch_up_ = options.max_catch_up_;
+    timer->priority_ = options.priority_;
+    timer->overload_ = options.overload_;
+    if (options.group_ != nullptr) {
+        timer->group_ = options.group_;
+        timer->group_generation_ = options.group_->generation_;
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addTimer(
+        const TimerPtr& timer) {
+    timer->manager_ = this;
+    if (timer->slack_ < Accuracy::zero()) {
+        timer->slack_ = default_slack_;
+    }
+    if (lock_free_) {
+        timer->submit_ref_ = timer;
+        submit(timer.get(), timer.get(), timer->deadline());
+        return;
+    }
+    std::vector<TimerPtr> dropped;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        if (insertTimer(timer, dropped)) {
+            // Alarm is not moved if it is in window of the timer.
+            auto alarm_time = alarmTimeOf(timer.get());
+            if (alarm_time < alarm_time_) {
+                setNewAlarm(alarm_time);
+            }
+        }
+    }
+    releaseDropped(dropped);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::schedule(
+        ScheduleBatch& batch) -> std::vector<TimerHandle> {
+    std::vector<TimerPtr> timers;
+    timers.swap(batch.timers_);
+    if (timers.empty()) {
+        return timers;
+    }
+    for (auto& timer : timers) {
+        timer->manager_ = this;
+        if (timer->slack_ < Accuracy::zero()) {
+            timer->slack_ = default_slack_;
+        }
+    }
+    if (lock_free_) {
+        // Link batch into one chain, push it by one CAS.
+        auto earliest = timers.front()->deadline();
+        for (size_t i = 0; i < timers.size(); ++i) {
+            timers[i]->submit_ref_ = timers[i];
+            if (i + 1 < timers.size()) {
+                timers[i]->submit_next_ = timers[i + 1].get();
+            }
+            if (timers[i]->deadline() < earliest) {
+                earliest = timers[i]->deadline();
+            }
+        }
+        submit(timers.front().get(), timers.back().get(), earliest);
+        return timers;
+    }
+    std::vector<TimerPtr> dropped;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        auto alarm_time = TimePoint::max();
+        for (auto& timer : timers) {
+            if (insertTimer(timer, dropped)) {
+                alarm_time = std::min(alarm_time, timer->deadline());
+            }
+        }
+        if (!storage_->empty()) {
+            alarm_time = std::max(alarm_time, storage_->nextExpiration());
+            if (alarm_time < alarm_time_) {
+                setNewAlarm(alarm_time);
+            }
+        }
+    }
+    releaseDropped(dropped);
+    return timers;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::insertTimer(
+        const TimerPtr& timer, std::vector<TimerPtr>& dropped) {
+    if (!linkTimer(timer.get())) {
+        dropped.push_back(timer);
+        return false;
+    }
+    // Storage only link raw pointer, keep timer alive while pending.
+    timer->pending_ref_ = timer;
+    unmarkPopped(timer.get());
+    storage_->insert(timer.get());
+    ++pending_;
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::linkTimer(Timer* timer) {
+    if (timer->group_ != nullptr) {
+        if (timer->group_generation_ != timer->group_->generation_) {
+            // Group is cancelled after the job is added.
+            timer->repeat_ = false;
+            timer->cancelled_ = true;
+            return false;
+        }
+        timer->group_->link(timer);
+    }
+    if (timer->persistent_) {
+        linkPersistent(timer);
+    }
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::unlinkTimer(Timer* timer) {
+    if (timer->group_ != nullptr) {
+        timer->group_->unlink(timer);
+    }
+    if (timer->persistent_) {
+        unlinkPersistent(timer);
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::linkPersistent(Timer* timer) {
+    // Appended at tail, a running snapshot walking to tail sees it.
+    timer->persistent_prev_ = persistent_tail_;
+    timer->persistent_next_ = nullptr;
+    if (persistent_tail_ != nullptr) {
+        persistent_tail_->persistent_next_ = timer;
+    } else {
+        persistent_head_ = timer;
+    }
+    persistent_tail_ = timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::unlinkPersistent(Timer* timer) {
+    if (timer->persistent_prev_ != nullptr) {
+        timer->persistent_prev_->persistent_next_ = timer->persistent_next_;
+    } else {
+        persistent_head_ = timer->persistent_next_;
+    }
+    if (timer->persistent_next_ != nullptr) {
+        timer->persistent_next_->persistent_prev_ = timer->persistent_prev_;
+    } else {
+        persistent_tail_ = timer->persistent_prev_;
+    }
+    timer->persistent_prev_ = nullptr;
+    timer->persistent_next_ = nullptr;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+size_t BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::cancelGroup(
+        const std::shared_ptr<TimerGroup>& group) {
+    if (group == nullptr) {
+        return 0;
+    }
+    if (lock_free_) {
+        ++group->generation_;
+        size_t count = group->pending_;
+        if (group->cancel_queued_.exchange(true)) {
+            return count;
+        }
+        group->cancel_ref_ = group;
+        TimerGroup* head = group_cancel_head_.load(std::memory_order_relaxed);
+        do {
+            group->cancel_next_ = head;
+        } while (!group_cancel_head_.compare_exchange_weak(head, group.get()));
+        return count;
+    }
+    std::vector<TimerPtr> erased;
+    erased.reserve(group->pending_);
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        ++group->generation_;
+        eraseGroup(group.get(), erased);
+    }
+    // Callbacks (and packaged tasks) are destroyed out of lock.
+    for (auto& timer : erased) {
+        timer->cb_func_ = nullptr;
+    }
+    return erased.size();
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::eraseGroup(
+        TimerGroup* group, std::vector<TimerPtr>& erased) {
+    while (group->head_ != nullptr) {
+        Timer* timer = group->head_;
+        unlinkTimer(timer);
+        storage_->erase(timer);
+        --pending_;
+        timer->repeat_ = false;
+        timer->cancelled_ = true;
+        erased.push_back(std::move(timer->pending_ref_));
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::cancel(
+        const TimerHandle& timer) {
+    if (timer == nullptr || timer->manager_ != this) {
+        return false;
+    }
+    if (lock_free_) {
+        timer->repeat_ = false;
+        timer->cancelled_ = true;
+        if (timer->cancel_queued_.exchange(true)) {
+            return false;
+        }
+        timer->cancel_ref_ = timer;
+        Timer* head = cancel_head_.load(std::memory_order_relaxed);
+        do {
+            timer->cancel_next_ = head;
+        } while (!cancel_head_.compare_exchange_weak(head, timer.get()));
+        return true;
+    }
+    TimerPtr pending;
+    Timer::CallBackFunc cb_func;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        timer->repeat_ = false;
+        if (timer->pending_ref_ == nullptr) {
+            // Popped timer is dispatched as usual.
+            return false;
+        }
+        timer->cancelled_ = true;
+        storage_->erase(timer.get());
+        unlinkTimer(timer.get());
+        --pending_;
+        pending = std::move(timer->pending_ref_);
+        cb_func = std::move(timer->cb_func_);
+        timer->cb_func_ = nullptr;
+    }
+    // Callback (and packaged task) is destroyed out of lock.
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::repeatFunc(
+        const TimerPtr& timer, std::vector<TimerPtr>& dropped) {
+    return nextRepeat(timer) && insertTimer(timer, dropped);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::nextRepeat(
+        const TimerPtr& timer) {
+    if (timer->repeat_ && timer->cron_ != nullptr && nextCron(timer.get())) {
+        return true;
+    }
+    if (timer->repeat_ &&
+        timer->duration_ > Accuracy::zero()) {
+        if (timer->missed_tick_ == MissedTick::FixedDelay) {
+            // Called after callback is finished.
+            timer->expiration_ = std::chrono::time_point_cast<Accuracy>(
+                    ClockPolicy::submit() + timer->duration_);
+            return true;
+        }
+        timer->expiration_ += timer->duration_;
+        uint32_t max_catch_up = timer->missed_tick_ == MissedTick::Skip ?
+                0 : timer->max_catch_up_;
+        if (max_catch_up == UINT32_MAX) {
+            return true;
+        }
+        // Jump over missed periods at once instead of firing (or dropping
+        // by over time) them one by one.
+        auto now = ClockPolicy::submit();
+        if (timer->expiration_ <= now) {
+            auto missed = static_cast<uint64_t>((now - timer->expiration_) / timer->duration_) + 1;
+            if (missed > max_catch_up) {
+                timer->expiration_ += timer->duration_ *
+                        static_cast<Accuracy::rep>(missed - max_catch_up);
+            }
+        }
+        return true;
+    }
+    // Timer is finished, release bound arguments.
+    timer->cb_func_ = nullptr;
+    return false;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::nextCron(Timer* timer) {
+    // Wall clock is mapped to steady clock on every run, so clock
+    // adjustment doesn't accumulate.
+    auto system_now = std::chrono::system_clock::now();
+    auto next = timer->cron_->next(system_now);
+    if (next == std::chrono::system_clock::time_point::max()) {
+        return false;
+    }
+    timer->expiration_ = std::chrono::time_point_cast<Accuracy>(
+            ClockPolicy::submit() + std::chrono::duration_cast<Accuracy>(next - system_now));
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::finishRepeat(
+        const TimerPtr& timer) {
+    if (lock_free_) {
+        // Only loop thread touch storage, send timer back by queue.
+        // Cancel racing with it is checked again when loop drains it.
+        if (!timer->cancelled_ && nextRepeat(timer)) {
+            timer->submit_ref_ = timer;
+            submit(timer.get(), timer.get(), timer->deadline());
+        }
+        return;
+    }
+    std::vector<TimerPtr> dropped;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        if (repeatFunc(timer, dropped)) {
+            auto alarm_time = alarmTimeOf(timer.get());
+            if (alarm_time < alarm_time_) {
+                setNewAlarm(alarm_time);
+            }
+        }
+    }
+    releaseDropped(dropped);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::submit(
+        Timer* first, Timer* last, TimePoint earliest) {
+    // Timers may be fired by loop once pushed, don't touch them after.
+    Timer* head = submit_head_.load(std::memory_order_relaxed);
+    do {
+        last->submit_next_ = head;
+    } while (!submit_head_.compare_exchange_weak(head, first));
+    wakeIfEarlier(earliest);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::wakeIfEarlier(
+        const TimePoint& earliest) {
+    // Only one producer wakes the sleeping loop up.
+    auto deadline = sleep_deadline_.load();
+    while (earliest.time_since_epoch().count() < deadline) {
+        if (sleep_deadline_.compare_exchange_weak(deadline,
+                TimePoint::min().time_since_epoch().count())) {
+            wakeUp();
+            break;
+        }
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::drainSubmitted(
+        std::vector<TimerPtr>& dropped) {
+    // Queue is LIFO, reverse it to keep adding order.
+    Timer* timer = submit_head_.exchange(nullptr);
+    Timer* reversed = nullptr;
+    while (timer != nullptr) {
+        Timer* next = timer->submit_next_;
+        timer->submit_next_ = reversed;
+        reversed = timer;
+        timer = next;
+    }
+    while (reversed != nullptr) {
+        Timer* next = reversed->submit_next_;
+        reversed->submit_next_ = nullptr;
+        TimerPtr ref = std::move(reversed->submit_ref_);
+        // Cancelled before it reaches storage, e.g. a repeat timer sent
+        // back after its cancel request is handled.
+        if (!reversed->cancelled_ && linkTimer(reversed)) {
+            reversed->pending_ref_ = std::move(ref);
+            unmarkPopped(reversed);
+            storage_->insert(reversed);
+            ++pending_;
+        } else {
+            dropped.push_back(std::move(ref));
+        }
+        reversed = next;
+    }
+    // Handle cancel requests after submitted timers are in storage.
+    timer = cancel_head_.exchange(nullptr);
+    while (timer != nullptr) {
+        Timer* next = timer->cancel_next_;
+        TimerPtr ref = std::move(timer->cancel_ref_);
+        if (timer->pending_ref_ != nullptr) {
+            storage_->erase(timer);
+            unlinkTimer(timer);
+            --pending_;
+            dropped.push_back(std::move(timer->pending_ref_));
+        }
+        timer = next;
+    }
+    TimerGroup* group = group_cancel_head_.exchange(nullptr);
+    while (group != nullptr) {
+        TimerGroup* next = group->cancel_next_;
+        std::shared_ptr<TimerGroup> ref = std::move(group->cancel_ref_);
+        group->cancel_queued_ = false;
+        eraseGroup(group, dropped);
+        group = next;
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::releaseDropped(
+        std::vector<TimerPtr>& dropped) {
+    // Callback may resume a coroutine which adds timers, never under lock.
+    for (auto& timer : dropped) {
+        timer->cb_func_ = nullptr;
+    }
+    dropped.clear();
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::wakeUp() {
+#ifdef __linux__
+    if (alarm_type_ == AlarmType::TimerFd) {
+        if (event_fd_ != -1) {
+            uint64_t value = 1;
+            ssize_t ret = write(event_fd_, &value, sizeof(value));
+            (void)ret;
+        }
+        return;
+    }
+#endif
+    alarm();
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::setNewAlarm(
+        const TimePoint& expiration) {
+    ++rearms_;
+    spin_until_ = expiration.time_since_epoch().count();
+    // Armed by absolute time of CLOCK_MONOTONIC (steady clock), no clock
+    // read. Earlier by spin window in high precision mode, time passed
+    // fires at once.
+    auto alarm_time = std::max(expiration.time_since_epoch() - spin_window_, Accuracy(1));
+    struct itimerspec in_value{};
+    auto seconds = std::chrono::duration_cast<Seconds>(alarm_time);
+    in_value.it_value.tv_sec = seconds.count();
+    in_value.it_value.tv_nsec = std::chrono::duration_cast<NanoSec>(alarm_time - seconds).count();
+#ifdef __linux__
+    if (alarm_type_ == AlarmType::TimerFd) {
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &in_value, nullptr);
+        alarm_time_ = expiration;
+        return;
+    }
+#endif
+    timer_settime(timer_id_, TIMER_ABSTIME, &in_value, nullptr);
+    alarm_time_ = expiration;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::spinToAlarm() -> TimePoint {
+    auto now = std::chrono::time_point_cast<Accuracy>(ClockPolicy::wakeup());
+    for (;;) {
+        TimePoint target{Accuracy(spin_until_.load(std::memory_order_relaxed))};
+        // Woken up for other reason than the alarm.
+        if (now >= target || target - now > spin_window_ || !running_) {
+            break;
+        }
+        // New timers are drained by handleExpired(). (Lock free submit mode)
+        if (lock_free_ && submit_head_ != nullptr) {
+            break;
+        }
+        cpuRelax();
+        now = std::chrono::time_point_cast<Accuracy>(ClockPolicy::wakeup());
+    }
+    return now;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::runCallback(
+        Timer::CallBackFunc& cb_func) {
+    auto begin = ClockPolicy::now();
+    cb_func();
+    run_time_.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<NanoSec>(ClockPolicy::now() - begin).count()));
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::finishJob() {
+    // Decrement under lock, destructor can't pass its wait (and free
+    // the manager) until the job stops touching it.
+    std::lock_guard<std::mutex> lock(in_flight_mutex_);
+    --running_jobs_;
+    in_flight_cv_.notify_one();
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::waitInFlight() {
+    // Batched jobs are counted in flight, hand them to executor first.
+    flushDispatch();
+    ++overload_blocks_;
+    std::unique_lock<std::mutex> lock(in_flight_mutex_);
+    in_flight_cv_.wait(lock, [this]() {
+        return running_jobs_ < max_in_flight_;
+    });
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::flushDispatch() {
+    if (DispatchPolicy::Executor && !dispatch_.empty()) {
+        executor_->executeOrdered(dispatch_, orders_);
+        orders_.clear();
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::recordQueueWait(
+        const Clock::time_point& enqueue_time,
+        TimerPriority priority) {
+    auto wait = static_cast<uint64_t>(
+            std::chrono::duration_cast<NanoSec>(ClockPolicy::now() - enqueue_time).count());
+    queue_wait_.record(wait);
+    class_queue_wait_[static_cast<size_t>(priority)].record(wait);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+TimerStats BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::stats() const {
+    TimerStats stats;
+    stats.wakeups = wakeups_;
+    stats.wakeups_saved = wakeups_saved_;
+    stats.rearms = rearms_;
+    stats.fired = fired_;
+    stats.over_time_drops = over_time_drops_;
+    stats.extends = extends_;
+    stats.overload_drops = overload_drops_;
+    stats.overload_inline = overload_inline_;
+    stats.overload_blocks = overload_blocks_;
+    stats.in_flight = running_jobs_;
+    stats.pending = pending_;
+    stats.fire_lag = fire_lag_.snapshot();
+    stats.queue_wait = queue_wait_.snapshot();
+    for (size_t i = 0; i < TimerStats::PriorityNum; ++i) {
+        stats.class_queue_wait[i] = class_queue_wait_[i].snapshot();
+    }
+    stats.run_time = run_time_.snapshot();
+    return stats;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::alarmTimeOf(
+        const Timer* timer) const -> TimePoint {
+    // Storage may fire later than expiration. (Tick of timing wheel)
+    return std::max(timer->deadline(), storage_->nextExpiration());
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::alarmFunction(
+        union sigval val) {
+    auto mt_ptr = static_cast<BasicManagerTimer*>(val.sival_ptr);
+    mt_ptr->alarm();
+}
+
+#endif //MANAGER_TIMER_INL_H
@@ -0,0 +1,122 @@
+#include "priority_executor.h"
+
+#include <algorithm>
+
+bool PriorityExecutor::Later::operator()(const Task& a, const Task& b) const {
+    if (a.order.priority != b.order.priority) {
+        return a.order.priority > b.order.priority;
+    }
+    if (a.order.deadline != b.order.deadline) {
+        return a.order.deadline > b.order.deadline;
+    }
+    return a.seq > b.seq;
+}
+
+PriorityExecutor::PriorityExecutor(size_t threads) :
+        seq_(0),
+        stop_(false) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&PriorityExecutor::run, this);
+    }
+}
+
+PriorityExecutor::~PriorityExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool PriorityExecutor::setThreadOptions(const ThreadOptions& options, char* err) {
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (!applyThreadOptions(threads_[i].native_handle(), options,
+                static_cast<int>(i), err)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PriorityExecutor::execute(Callback task) {
+    execute(std::move(task),
+            TaskOrder{TimerPriority::Normal, std::chrono::steady_clock::now()});
+}
+
+void PriorityExecutor::execute(Callback task, const TaskOrder& order) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        push(std::move(task), order);
+    }
+    notify(1);
+}
+
+void PriorityExecutor::executeBatch(std::vector<Callback>& tasks) {
+    TaskOrder order{TimerPriority::Normal, std::chrono::steady_clock::now()};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& task : tasks) {
+            push(std::move(task), order);
+        }
+    }
+    notify(tasks.size());
+    tasks.clear();
+}
+
+void PriorityExecutor::executeOrdered(std::vector<Callback>& tasks,
+        const std::vector<TaskOrder>& orders) {
+    if (orders.size() != tasks.size()) {
+        executeBatch(tasks);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            push(std::move(tasks[i]), orders[i]);
+        }
+    }
+    notify(tasks.size());
+    tasks.clear();
+}
+
+void PriorityExecutor::push(Callback&& task, const TaskOrder& order) {
+    heap_.push_back(Task{order, seq_++, std::move(task)});
+    std::push_heap(heap_.begin(), heap_.end(), Later());
+}
+
+void PriorityExecutor::notify(size_t tasks) {
+    // Wake just enough workers. Worker checks heap under lock before
+    // waiting, so no task is missed.
+    if (tasks >= threads_.size()) {
+        cv_.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < tasks; ++i) {
+        cv_.notify_one();
+    }
+}
+
+void PriorityExecutor::run() {
+    for (;;) {
+        Callback task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() {
+                return stop_ || !heap_.empty();
+            });
+            if (heap_.empty()) {
+                break;
+            }
+            std::pop_heap(heap_.begin(), heap_.end(), Later());
+            task = std::move(heap_.back().func);
+            heap_.pop_back();
+        }
+        task();
+    }
+}
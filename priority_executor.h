@@ -0,0 +1,76 @@
+#ifndef PRIORITY_EXECUTOR_H
+#define PRIORITY_EXECUTOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "timer_executor.h"
+#include "timer_thread.h"
+
+// Ready tasks are run by priority class, then by earliest deadline (EDF),
+// so a flood of low priority callbacks can't delay a high priority one
+// behind them. One shared heap, tasks without order are Normal & due now.
+// Remaining tasks are run before destroyed.
+class PriorityExecutor final : public TimerExecutor {
+public:
+    explicit PriorityExecutor(size_t threads);
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator= (const PriorityExecutor&) = delete;
+    ~PriorityExecutor() override;
+
+    void execute(Callback task) override;
+    void execute(Callback task, const TaskOrder& order);
+    void executeBatch(std::vector<Callback>& tasks) override;
+    // All tasks are pushed under one lock.
+    void executeOrdered(std::vector<Callback>& tasks,
+            const std::vector<TaskOrder>& orders) override;
+    // Same as ThreadPool::enqueue, task is Normal & due now.
+    template <typename F, typename... Args>
+    auto enqueue(F&& f, Args&&... args)
+            -> std::future<typename std::result_of<F(Args...)>::type>;
+    size_t size() const {
+        return threads_.size();
+    }
+    // Placement of workers, worker i is named "name-i".
+    bool setThreadOptions(const ThreadOptions& options, char* err = nullptr);
+
+private:
+    struct Task {
+        TaskOrder order;
+        uint64_t seq; // FIFO in the same order
+        Callback func;
+    };
+    // Heap top is the task to run first.
+    struct Later {
+        bool operator()(const Task& a, const Task& b) const;
+    };
+    void push(Callback&& task, const TaskOrder& order); // Lock held
+    void notify(size_t tasks);
+    void run();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Task> heap_; // Protect by mutex_
+    uint64_t seq_; // Protect by mutex_
+    bool stop_; // Protect by mutex_
+};
+
+template <typename F, typename... Args>
+auto PriorityExecutor::enqueue(F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type> {
+    using return_type = typename std::result_of<F(Args...)>::type;
+    std::packaged_task<return_type()> task(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    auto future = task.get_future();
+    execute(std::move(task));
+    return future;
+}
+
+#endif //PRIORITY_EXECUTOR_H
@@ -0,0 +1,99 @@
+#include "sharded_manager_timer.h"
+
+ShardedManagerTimer::ShardedManagerTimer(size_t shard_num,
+        ThreadPool* thread_pool) {
+    if (shard_num == 0) {
+        shard_num = 1;
+    }
+    shards_.reserve(shard_num);
+    for (size_t i = 0; i < shard_num; ++i) {
+        shards_.emplace_back(new ManagerTimer(thread_pool));
+    }
+}
+
+bool ShardedManagerTimer::init(char* err) {
+    for (auto& shard : shards_) {
+        if (!shard->init(err)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShardedManagerTimer::start(char* err) {
+    for (auto& shard : shards_) {
+        if (!shard->start(err)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShardedManagerTimer::stopAndJoin() {
+    for (auto& shard : shards_) {
+        shard->stopAndJoin();
+    }
+}
+
+void ShardedManagerTimer::setThreadPool(ThreadPool* tp) {
+    for (auto& shard : shards_) {
+        shard->setThreadPool(tp);
+    }
+}
+
+bool ShardedManagerTimer::setLockFreeSubmit(bool enable) {
+    bool ret = true;
+    for (auto& shard : shards_) {
+        ret = shard->setLockFreeSubmit(enable) && ret;
+    }
+    return ret;
+}
+
+void ShardedManagerTimer::setExecutor(TimerExecutor* executor) {
+    for (auto& shard : shards_) {
+        shard->setExecutor(executor);
+    }
+}
+
+void ShardedManagerTimer::setMaxInFlight(size_t max) {
+    for (auto& shard : shards_) {
+        shard->setMaxInFlight(max);
+    }
+}
+
+ManagerTimer& ShardedManagerTimer::localShard() {
+    static std::atomic<size_t> thread_count(0);
+    thread_local size_t thread_index = thread_count++;
+    return shard(thread_index);
+}
+
+bool ShardedManagerTimer::cancel(const TimerHandle& timer) {
+    ManagerTimer* owner = ownerOf(timer);
+    return owner != nullptr && owner->cancel(timer);
+}
+
+bool ShardedManagerTimer::extend(const TimerHandle& timer,
+        const std::chrono::time_point<Clock, Accuracy>& expiration) {
+    ManagerTimer* owner = ownerOf(timer);
+    return owner != nullptr && owner->extend(timer, expiration);
+}
+
+ManagerTimer* ShardedManagerTimer::ownerOf(const TimerHandle& timer) const {
+    if (timer == nullptr) {
+        return nullptr;
+    }
+    for (auto& shard : shards_) {
+        if (shard.get() == timer->manager_) {
+            return shard.get();
+        }
+    }
+    return nullptr;
+}
+
+TimerStats ShardedManagerTimer::stats() const {
+    TimerStats stats;
+    for (auto& shard : shards_) {
+        stats += shard->stats();
+    }
+    return stats;
+}
@@ -0,0 +1,101 @@
+#ifndef SHARDED_MANAGER_TIMER_H
+#define SHARDED_MANAGER_TIMER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "manager_timer.h"
+
+// Own N independent ManagerTimer shards, every shard has its own storage,
+// system timer & loop thread. Jobs are routed by calling thread, or by key
+// through shardOf(key). Producers on different shards never contend.
+class ShardedManagerTimer {
+public:
+    using Clock = ManagerTimer::Clock;
+    using Accuracy = ManagerTimer::Accuracy;
+    using TimerHandle = ManagerTimer::TimerHandle;
+
+    explicit ShardedManagerTimer(size_t shard_num,
+            ThreadPool* thread_pool = nullptr);
+    ShardedManagerTimer(const ShardedManagerTimer&) = delete;
+    ShardedManagerTimer& operator= (const ShardedManagerTimer&) = delete;
+
+    bool init(char* err = nullptr);
+    bool start(char* err = nullptr);
+    void stopAndJoin();
+
+    void setThreadPool(ThreadPool* tp);
+    void setExecutor(TimerExecutor* executor);
+    // Limit of each shard.
+    void setMaxInFlight(size_t max);
+    template <typename A>
+    void setOverTime(const A& duration) {
+        for (auto& shard : shards_) {
+            shard->setOverTime(duration);
+        }
+    }
+    template <typename A>
+    void setDefaultSlack(const A& slack) {
+        for (auto& shard : shards_) {
+            shard->setDefaultSlack(slack);
+        }
+    }
+    bool setLockFreeSubmit(bool enable);
+    template <typename A>
+    bool setTimingWheel(const A& tick, unsigned int levels = 4) {
+        bool ret = true;
+        for (auto& shard : shards_) {
+            ret = shard->setTimingWheel(tick, levels) && ret;
+        }
+        return ret;
+    }
+
+    size_t shardCount() const {
+        return shards_.size();
+    }
+    ManagerTimer& shard(size_t index) {
+        return *shards_[index % shards_.size()];
+    }
+    // Shard of calling thread. Threads are spread over shards round robin.
+    ManagerTimer& localShard();
+    // Shard of key. Same key always go to the same shard.
+    template <typename Key>
+    ManagerTimer& shardOf(const Key& key) {
+        return shard(std::hash<Key>()(key));
+    }
+    // Cancel on the shard which timer is added to.
+    bool cancel(const TimerHandle& timer);
+    // Extend on the shard which timer is added to.
+    bool extend(const TimerHandle& timer,
+            const std::chrono::time_point<Clock, Accuracy>& expiration);
+    // Sum of stats of all shards.
+    TimerStats stats() const;
+
+    // Same as ManagerTimer, job is added to localShard().
+    template <typename... Ts>
+    auto addJobRunAt(Ts&&... ts)
+            -> decltype(std::declval<ManagerTimer&>().addJobRunAt(std::forward<Ts>(ts)...)) {
+        return localShard().addJobRunAt(std::forward<Ts>(ts)...);
+    }
+    template <typename... Ts>
+    auto addJobRunAfter(Ts&&... ts)
+            -> decltype(std::declval<ManagerTimer&>().addJobRunAfter(std::forward<Ts>(ts)...)) {
+        return localShard().addJobRunAfter(std::forward<Ts>(ts)...);
+    }
+    template <typename... Ts>
+    auto addJobRunEvery(Ts&&... ts)
+            -> decltype(std::declval<ManagerTimer&>().addJobRunEvery(std::forward<Ts>(ts)...)) {
+        return localShard().addJobRunEvery(std::forward<Ts>(ts)...);
+    }
+
+private:
+    // Shard which timer is added to, nullptr if none.
+    ManagerTimer* ownerOf(const TimerHandle& timer) const;
+
+    std::vector<std::unique_ptr<ManagerTimer>> shards_;
+};
+
+#endif //SHARDED_MANAGER_TIMER_H
@@ -0,0 +1,340 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "timer_callback.h"
+#include "timer_executor.h"
+#include "timer_pool.h"
+
+class CronJob;
+class TimerGroup;
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+class BasicManagerTimer;
+
+// What a repeat timer does after it missed periods. (Stall or overload)
+// CatchUp: fixed rate, missed periods are fired back to back. (Default)
+// Skip: fire once, then go on with the next period not passed yet.
+// FixedDelay: next run is duration after callback is finished.
+enum class MissedTick : uint8_t {
+    CatchUp,
+    Skip,
+    FixedDelay
+};
+
+// What an expired callback does when in flight callbacks are at limit.
+// (See setMaxInFlight)
+// Block: loop waits until one finishes. (Default)
+// Drop: callback is skipped like over time, isOverTime() is true.
+// Inline: callback is run in loop thread.
+enum class OverloadPolicy : uint8_t {
+    Block,
+    Drop,
+    Inline
+};
+
+class Timer {
+    template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+    friend class BasicManagerTimer;
+    friend class ShardedManagerTimer;
+    friend class TimerStorage;
+    friend class TimerMapStorage;
+    friend class TimerHeapStorage;
+    friend class TimingWheelStorage;
+    friend class TimerGroup;
+    // Time points are of steady clock, ClockPolicy of manager decides how
+    // it's read.
+    using Clock = std::chrono::steady_clock;
+    using Accuracy = Clock::duration;
+    using TimePoint = std::chrono::time_point<Clock, Accuracy>;
+    using CallBackFunc = Callback;
+    using TimerMap = std::multimap<TimePoint, Timer*, std::less<TimePoint>,
+            PoolAllocator<std::pair<const TimePoint, Timer*>>>;
+    using MapIterator = TimerMap::iterator;
+public:
+    explicit Timer(const TimePoint& expiration) :
+            repeat_(false),
+            cancelled_(false),
+            is_over_time_(false),
+            expiration_(expiration),
+            duration_(Accuracy::zero()),
+            handling_time_(Accuracy::max()),
+            slack_(-1),
+            missed_tick_(MissedTick::CatchUp),
+            max_catch_up_(UINT32_MAX),
+            priority_(TimerPriority::Normal),
+            overload_(OverloadPolicy::Block),
+            extended_(NotExtended),
+            manager_(nullptr),
+            prev_(nullptr),
+            next_(nullptr),
+            wheel_tick_(0),
+            wheel_slot_(0),
+            heap_index_(0),
+            group_generation_(0),
+            group_prev_(nullptr),
+            group_next_(nullptr),
+            submit_next_(nullptr),
+            cancel_next_(nullptr),
+            cancel_queued_(false),
+            persistent_(false),
+            persistent_prev_(nullptr),
+            persistent_next_(nullptr),
+            snapshot_stamp_(0) { }
+    explicit Timer(const Accuracy& duration) :
+            repeat_(true),
+            cancelled_(false),
+            is_over_time_(false),
+            expiration_(std::chrono::time_point_cast<Accuracy>(
+                    Clock::now() + duration)),
+            duration_(duration),
+            handling_time_(Accuracy::max()),
+            slack_(-1),
+            missed_tick_(MissedTick::CatchUp),
+            max_catch_up_(UINT32_MAX),
+            priority_(TimerPriority::Normal),
+            overload_(OverloadPolicy::Block),
+            extended_(NotExtended),
+            manager_(nullptr),
+            prev_(nullptr),
+            next_(nullptr),
+            wheel_tick_(0),
+            wheel_slot_(0),
+            heap_index_(0),
+            group_generation_(0),
+            group_prev_(nullptr),
+            group_next_(nullptr),
+            submit_next_(nullptr),
+            cancel_next_(nullptr),
+            cancel_queued_(false),
+            persistent_(false),
+            persistent_prev_(nullptr),
+            persistent_next_(nullptr),
+            snapshot_stamp_(0) { }
+    Timer(const TimePoint& expiration, const Accuracy& duration) :
+            repeat_(true),
+            cancelled_(false),
+            is_over_time_(false),
+            expiration_(expiration),
+            duration_(duration),
+            handling_time_(Accuracy::max()),
+            slack_(-1),
+            missed_tick_(MissedTick::CatchUp),
+            max_catch_up_(UINT32_MAX),
+            priority_(TimerPriority::Normal),
+            overload_(OverloadPolicy::Block),
+            extended_(NotExtended),
+            manager_(nullptr),
+            prev_(nullptr),
+            next_(nullptr),
+            wheel_tick_(0),
+            wheel_slot_(0),
+            heap_index_(0),
+            group_generation_(0),
+            group_prev_(nullptr),
+            group_next_(nullptr),
+            submit_next_(nullptr),
+            cancel_next_(nullptr),
+            cancel_queued_(false),
+            persistent_(false),
+            persistent_prev_(nullptr),
+            persistent_next_(nullptr),
+            snapshot_stamp_(0) { }
+    void stopRepeat() {
+        repeat_ = false;
+    }
+    bool isCancelled() const {
+        return cancelled_;
+    }
+    bool isOverTime() const {
+        return is_over_time_;
+    }
+    TimePoint getHandlingTime() const {
+        return handling_time_;
+    }
+
+private:
+    std::atomic_bool repeat_;
+    std::atomic_bool cancelled_;
+    std::atomic_bool is_over_time_;
+    TimePoint expiration_;
+    Accuracy duration_;
+    TimePoint handling_time_;
+    CallBackFunc cb_func_;
+    // Timer may fire at most slack_ late. Negative is manager default.
+    Accuracy slack_;
+    // Repeat timer only. At most max_catch_up_ missed periods are fired
+    // by CatchUp, UINT32_MAX is unlimited.
+    MissedTick missed_tick_;
+    uint32_t max_catch_up_;
+    TimerPriority priority_;
+    OverloadPolicy overload_;
+    // Expiration set by ManagerTimer::extend(), in Accuracy ticks.
+    // Storage entry keeps expiration_, timer is moved when it's popped.
+    // Popped: timer has left storage to fire, extend() fails until it's
+    // added back (repeat).
+    static constexpr int64_t NotExtended = INT64_MIN;
+    static constexpr int64_t Popped = INT64_MIN + 1;
+    std::atomic<int64_t> extended_;
+    // Next expirations of a cron job, duration_ is not used.
+    std::shared_ptr<CronJob> cron_;
+
+    // Repeat by duration or cron.
+    bool periodic() const {
+        return duration_ > Accuracy::zero() || cron_ != nullptr;
+    }
+    // Latest time point timer should fire at.
+    TimePoint deadline() const {
+        if (expiration_ > TimePoint::max() - slack_) {
+            return TimePoint::max();
+        }
+        return expiration_ + slack_;
+    }
+
+    // Which manager timer is added to, only compared.
+    const void* manager_;
+    // Storage bookkeeping. Protected by ManagerTimer::map_mutex_.
+    // Storage hold raw pointer, pending_ref_ keep timer alive until
+    // it is popped or erased from storage.
+    std::shared_ptr<Timer> pending_ref_;
+    MapIterator map_iter_;
+    Timer* prev_;
+    Timer* next_;
+    uint64_t wheel_tick_;
+    unsigned int wheel_slot_;
+    size_t heap_index_;
+    // Pending timers of a group are linked, group_generation_ is the
+    // generation of group when job is added.
+    std::shared_ptr<TimerGroup> group_;
+    uint64_t group_generation_;
+    Timer* group_prev_;
+    Timer* group_next_;
+    // Lock free submit mode. Link of submit & cancel queue, submit_ref_
+    // & cancel_ref_ keep timer alive until loop handle the request. Only
+    // loop thread set pending_ref_ in this mode.
+    Timer* submit_next_;
+    Timer* cancel_next_;
+    std::atomic_bool cancel_queued_;
+    std::shared_ptr<Timer> submit_ref_;
+    std::shared_ptr<Timer> cancel_ref_;
+    // Pending persistent jobs are linked for snapshot, snapshot_stamp_
+    // marks the ones saved by the running snapshot. Protected by
+    // ManagerTimer::map_mutex_.
+    bool persistent_;
+    Timer* persistent_prev_;
+    Timer* persistent_next_;
+    uint64_t snapshot_stamp_;
+};
+
+// Jobs of one owner (e.g. a session) cancelled together by cancelGroup(),
+// in time of group size. Timers of a group must be added to one manager.
+class TimerGroup {
+    template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+    friend class BasicManagerTimer;
+public:
+    TimerGroup() :
+            head_(nullptr),
+            pending_(0),
+            generation_(0),
+            cancel_next_(nullptr),
+            cancel_queued_(false) { }
+    TimerGroup(const TimerGroup&) = delete;
+    TimerGroup& operator= (const TimerGroup&) = delete;
+    // Count of pending timers in group.
+    size_t pending() const {
+        return pending_;
+    }
+
+private:
+    // Protected by map_mutex_ of manager.
+    void link(Timer* timer) {
+        timer->group_prev_ = nullptr;
+        timer->group_next_ = head_;
+        if (head_ != nullptr) {
+            head_->group_prev_ = timer;
+        }
+        head_ = timer;
+        ++pending_;
+    }
+    void unlink(Timer* timer) {
+        if (timer->group_prev_ != nullptr) {
+            timer->group_prev_->group_next_ = timer->group_next_;
+        } else {
+            head_ = timer->group_next_;
+        }
+        if (timer->group_next_ != nullptr) {
+            timer->group_next_->group_prev_ = timer->group_prev_;
+        }
+        timer->group_prev_ = nullptr;
+        timer->group_next_ = nullptr;
+        --pending_;
+    }
+
+    Timer* head_;
+    std::atomic<size_t> pending_;
+    // Bumped by cancelGroup(), running timers of older generation don't
+    // repeat.
+    std::atomic<uint64_t> generation_;
+    // Lock free submit mode. Link of group cancel queue, cancel_ref_ keep
+    // group alive until loop handle the cancel request.
+    TimerGroup* cancel_next_;
+    std::atomic_bool cancel_queued_;
+    std::shared_ptr<TimerGroup> cancel_ref_;
+};
+
+// Options of a single job.
+class TimerOptions {
+    template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+    friend class BasicManagerTimer;
+public:
+    TimerOptions() :
+            slack_(-1),
+            missed_tick_(MissedTick::CatchUp),
+            max_catch_up_(UINT32_MAX),
+            priority_(TimerPriority::Normal),
+            overload_(OverloadPolicy::Block) { }
+    // Job may be fired at most 'slack' late, so it can share one wakeup
+    // with nearby jobs. Manager default is used if not set.
+    template <typename A>
+    TimerOptions& setSlack(const A& slack) {
+        slack_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(slack);
+        return *this;
+    }
+    // Repeat job only. With CatchUp, at most max_catch_up missed periods
+    // are fired back to back, earlier ones are skipped.
+    TimerOptions& setMissedTick(MissedTick policy, uint32_t max_catch_up = UINT32_MAX) {
+        missed_tick_ = policy;
+        max_catch_up_ = max_catch_up;
+        return *this;
+    }
+    // Expired callbacks of higher class are dispatched first.
+    TimerOptions& setPriority(TimerPriority priority) {
+        priority_ = priority;
+        return *this;
+    }
+    // What job does when in flight callbacks of manager are at limit.
+    TimerOptions& setOverload(OverloadPolicy policy) {
+        overload_ = policy;
+        return *this;
+    }
+    // Job can be cancelled with other jobs of group by cancelGroup().
+    TimerOptions& setGroup(std::shared_ptr<TimerGroup> group) {
+        group_ = std::move(group);
+        return *this;
+    }
+
+private:
+    std::chrono::steady_clock::duration slack_;
+    MissedTick missed_tick_;
+    uint32_t max_catch_up_;
+    TimerPriority priority_;
+    OverloadPolicy overload_;
+    std::shared_ptr<TimerGroup> group_;
+};
+
+#endif //TIMER_H
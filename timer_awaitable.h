@@ -0,0 +1,307 @@
+#ifndef TIMER_AWAITABLE_H
+#define TIMER_AWAITABLE_H
+
+// Awaitables of ManagerTimer, only available when C++20 coroutines are
+// enabled. TIMER_HAS_COROUTINE is defined then.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define TIMER_HAS_COROUTINE 1
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "manager_timer.h"
+
+namespace timer_detail {
+
+using TimePoint = std::chrono::time_point<ManagerTimer::Clock, ManagerTimer::Accuracy>;
+
+// Shared by awaitable & its callbacks. Whoever claims first resumes
+// the coroutine (or gives it up when the frame is destroyed).
+struct ResumeState {
+    bool claim() {
+        return !claimed.exchange(true);
+    }
+
+    std::atomic_bool claimed{false};
+    bool dropped = false;
+    std::coroutine_handle<> handle;
+    ManagerTimer* manager = nullptr;
+    std::weak_ptr<Timer> timer; // No cycle with callback of timer
+};
+
+// Callback of the timer. A timer dropped (over time, OverloadPolicy::Drop
+// or cancelGroup()) destroys it without running, the coroutine is resumed
+// there with dropped set.
+struct ResumeCallback {
+    explicit ResumeCallback(std::shared_ptr<ResumeState> state) : state(std::move(state)) { }
+    ResumeCallback(ResumeCallback&&) = default;
+    ~ResumeCallback() {
+        if (state == nullptr) {
+            return;
+        }
+        auto timer = state->timer.lock();
+        if (timer != nullptr && (timer->isOverTime() || timer->isCancelled()) &&
+            state->claim()) {
+            state->dropped = true;
+            state->handle.resume();
+        }
+    }
+    void operator()() const {
+        if (state->claim()) {
+            state->handle.resume();
+        }
+    }
+
+    std::shared_ptr<ResumeState> state;
+};
+
+// Timer is published in state before it's added, the callback may run
+// or be dropped (and read state->timer) as soon as it's in storage.
+struct ArmTimer {
+    static void post(ManagerTimer& mt, const TimerOptions& options,
+            const TimePoint& expiration, const std::shared_ptr<ResumeState>& state) {
+        auto timer = ManagerTimer::makePostTimer(mt.node_pool_, expiration,
+                ResumeCallback(state));
+        ManagerTimer::applyOptions(timer.get(), options);
+        state->timer = timer;
+        mt.addTimer(timer);
+    }
+};
+
+inline void cancelTimer(ResumeState& state) {
+    auto timer = state.timer.lock();
+    if (timer != nullptr) {
+        state.manager->cancel(timer);
+    }
+}
+
+template <typename Awaitable>
+decltype(auto) awaiterOf(Awaitable&& awaitable) {
+    if constexpr (requires { static_cast<Awaitable&&>(awaitable).operator co_await(); }) {
+        return static_cast<Awaitable&&>(awaitable).operator co_await();
+    } else if constexpr (requires { operator co_await(static_cast<Awaitable&&>(awaitable)); }) {
+        return operator co_await(static_cast<Awaitable&&>(awaitable));
+    } else {
+        return static_cast<Awaitable&&>(awaitable);
+    }
+}
+
+template <typename Awaitable>
+using AwaitResult = decltype(awaiterOf(std::declval<Awaitable>()).await_resume());
+
+template <typename T>
+struct TimeoutState : ResumeState {
+    std::optional<T> value;
+    std::exception_ptr error;
+};
+
+template <>
+struct TimeoutState<void> : ResumeState {
+    bool done = false;
+    std::exception_ptr error;
+};
+
+// Coroutine started by hand, frame is freed when it finishes.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Await the inner awaitable, resume the waiting coroutine if timer
+// has not fired yet.
+template <typename Awaitable, typename T>
+DetachedTask awaitInner(Awaitable awaitable, std::shared_ptr<TimeoutState<T>> state) {
+    bool won = false;
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(awaitable);
+            if ((won = state->claim())) {
+                state->done = true;
+            }
+        } else {
+            auto value = co_await std::move(awaitable);
+            if ((won = state->claim())) {
+                state->value.emplace(std::move(value));
+            }
+        }
+    } catch (...) {
+        if ((won = state->claim())) {
+            state->error = std::current_exception();
+        }
+    }
+    if (won) {
+        cancelTimer(*state);
+        state->handle.resume();
+    }
+}
+
+} // namespace timer_detail
+
+// co_await sleepFor(mt, duration) / sleepUntil(mt, expiration).
+// Coroutine is resumed by whoever runs callbacks of mt (loop thread,
+// thread pool or executor), no future is created. Timer dropped (over
+// time, OverloadPolicy::Drop) resumes it in loop thread, dropped() is
+// true then.
+// Destroying the suspended coroutine cancels the timer. Manager must
+// outlive the awaitable.
+class SleepAwaitable {
+public:
+    SleepAwaitable(ManagerTimer& mt, const TimerOptions& options,
+            const timer_detail::TimePoint& expiration) :
+            mt_(&mt), options_(options), expiration_(expiration) { }
+    SleepAwaitable(SleepAwaitable&& other) noexcept :
+            mt_(other.mt_),
+            options_(std::move(other.options_)),
+            expiration_(other.expiration_),
+            state_(std::move(other.state_)) { }
+    SleepAwaitable(const SleepAwaitable&) = delete;
+    SleepAwaitable& operator= (const SleepAwaitable&) = delete;
+    ~SleepAwaitable() {
+        if (state_ != nullptr && state_->claim()) {
+            timer_detail::cancelTimer(*state_);
+        }
+    }
+
+    bool await_ready() const {
+        return expiration_ <= ManagerTimer::Clock::now();
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        state_ = std::make_shared<timer_detail::ResumeState>();
+        state_->handle = handle;
+        state_->manager = mt_;
+        // Coroutine may be resumed before postJobRunAt() returns,
+        // don't touch this after it.
+        auto state = state_;
+        timer_detail::ArmTimer::post(*mt_, options_, expiration_, state);
+    }
+    void await_resume() const { }
+    bool dropped() const {
+        return state_ != nullptr && state_->dropped;
+    }
+
+private:
+    ManagerTimer* mt_;
+    TimerOptions options_;
+    timer_detail::TimePoint expiration_;
+    std::shared_ptr<timer_detail::ResumeState> state_;
+};
+
+// co_await withTimeout(mt, awaitable, duration).
+// Result is std::optional of the awaited value (bool for void), empty
+// (false) on timeout. Exception of awaitable is rethrown. The awaitable
+// is not cancelled on timeout, it goes on in background & its result
+// is dropped. Dropped timer (see SleepAwaitable) is a timeout.
+template <typename Awaitable>
+class TimeoutAwaitable {
+public:
+    using Value = timer_detail::AwaitResult<Awaitable>;
+    using Result = std::conditional_t<std::is_void_v<Value>, bool,
+            std::optional<std::decay_t<Value>>>;
+
+    TimeoutAwaitable(ManagerTimer& mt, const TimerOptions& options, Awaitable awaitable,
+            const timer_detail::TimePoint& expiration) :
+            mt_(&mt),
+            options_(options),
+            awaitable_(std::move(awaitable)),
+            expiration_(expiration) { }
+    TimeoutAwaitable(TimeoutAwaitable&&) = default;
+    TimeoutAwaitable(const TimeoutAwaitable&) = delete;
+    TimeoutAwaitable& operator= (const TimeoutAwaitable&) = delete;
+    ~TimeoutAwaitable() {
+        if (state_ != nullptr && state_->claim()) {
+            timer_detail::cancelTimer(*state_);
+        }
+    }
+
+    bool await_ready() const {
+        return false;
+    }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> handle) {
+        state_ = std::make_shared<State>();
+        state_->handle = handle;
+        state_->manager = mt_;
+        auto state = state_;
+        auto inner = timer_detail::awaitInner<Awaitable, std::decay_t<Value>>(
+                std::move(awaitable_), state).handle;
+        timer_detail::ArmTimer::post(*mt_, options_, expiration_, state);
+        // Start awaitable by symmetric transfer.
+        return inner;
+    }
+    Result await_resume() {
+        if (state_->error) {
+            std::rethrow_exception(state_->error);
+        }
+        if constexpr (std::is_void_v<Value>) {
+            return state_->done;
+        } else {
+            return std::move(state_->value);
+        }
+    }
+
+private:
+    using State = timer_detail::TimeoutState<std::decay_t<Value>>;
+
+    ManagerTimer* mt_;
+    TimerOptions options_;
+    Awaitable awaitable_;
+    timer_detail::TimePoint expiration_;
+    std::shared_ptr<State> state_;
+};
+
+inline SleepAwaitable sleepUntil(ManagerTimer& mt, const TimerOptions& options,
+        const timer_detail::TimePoint& expiration) {
+    return SleepAwaitable(mt, options, expiration);
+}
+
+inline SleepAwaitable sleepUntil(ManagerTimer& mt, const timer_detail::TimePoint& expiration) {
+    return sleepUntil(mt, TimerOptions(), expiration);
+}
+
+template <typename Rep, typename Per>
+SleepAwaitable sleepFor(ManagerTimer& mt, const TimerOptions& options,
+        const std::chrono::duration<Rep, Per>& duration) {
+    return SleepAwaitable(mt, options, std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+            ManagerTimer::Clock::now() +
+            std::chrono::duration_cast<ManagerTimer::Accuracy>(duration)));
+}
+
+template <typename Rep, typename Per>
+SleepAwaitable sleepFor(ManagerTimer& mt, const std::chrono::duration<Rep, Per>& duration) {
+    return sleepFor(mt, TimerOptions(), duration);
+}
+
+template <typename Awaitable, typename Rep, typename Per>
+TimeoutAwaitable<std::decay_t<Awaitable>> withTimeout(ManagerTimer& mt,
+        const TimerOptions& options, Awaitable&& awaitable,
+        const std::chrono::duration<Rep, Per>& duration) {
+    return TimeoutAwaitable<std::decay_t<Awaitable>>(mt, options,
+            std::forward<Awaitable>(awaitable),
+            std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+                    ManagerTimer::Clock::now() +
+                    std::chrono::duration_cast<ManagerTimer::Accuracy>(duration)));
+}
+
+template <typename Awaitable, typename Rep, typename Per>
+TimeoutAwaitable<std::decay_t<Awaitable>> withTimeout(ManagerTimer& mt,
+        Awaitable&& awaitable, const std::chrono::duration<Rep, Per>& duration) {
+    return withTimeout(mt, TimerOptions(), std::forward<Awaitable>(awaitable), duration);
+}
+
+#endif // __cpp_impl_coroutine
+
+#endif //TIMER_AWAITABLE_H
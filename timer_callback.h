@@ -0,0 +1,151 @@
+#ifndef TIMER_CALLBACK_H
+#define TIMER_CALLBACK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move only 'void()' callable. Small callable (bound function & arguments)
+// is stored inline, so it doesn't allocate like std::function does.
+class Callback {
+public:
+    static const size_t InlineSize = 64;
+
+    Callback() noexcept : ops_(nullptr) { }
+    Callback(std::nullptr_t) noexcept : ops_(nullptr) { }
+    template <typename F, typename = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, Callback>::value>::type>
+    Callback(F&& func) : ops_(nullptr) {
+        construct(std::forward<F>(func));
+    }
+    Callback(Callback&& other) noexcept : ops_(other.ops_) {
+        if (ops_ != nullptr) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+    Callback(const Callback&) = delete;
+    Callback& operator= (const Callback&) = delete;
+    Callback& operator= (Callback&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops_ != nullptr) {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+    Callback& operator= (std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+    ~Callback() {
+        reset();
+    }
+
+    void operator()() {
+        ops_->invoke(&storage_);
+    }
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+    // Stored callable if its type is F, otherwise nullptr.
+    template <typename F>
+    F* target() noexcept {
+        if (ops_ == &InlineOps<F>::ops) {
+            return reinterpret_cast<F*>(&storage_);
+        }
+        if (ops_ == &HeapOps<F>::ops) {
+            return *reinterpret_cast<F**>(&storage_);
+        }
+        return nullptr;
+    }
+
+private:
+    using Storage = typename std::aligned_storage<
+            InlineSize, alignof(std::max_align_t)>::type;
+    struct Ops {
+        void (*invoke)(void* storage);
+        // Move to dst & destroy src.
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+    template <typename F>
+    struct InlineOps {
+        static void invoke(void* storage) {
+            (*static_cast<F*>(storage))();
+        }
+        static void move(void* dst, void* src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void destroy(void* storage) {
+            static_cast<F*>(storage)->~F();
+        }
+        static const Ops ops;
+    };
+    template <typename F>
+    struct HeapOps {
+        static void invoke(void* storage) {
+            (**static_cast<F**>(storage))();
+        }
+        static void move(void* dst, void* src) {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+        static void destroy(void* storage) {
+            delete *static_cast<F**>(storage);
+        }
+        static const Ops ops;
+    };
+    template <typename F>
+    struct IsInline : std::integral_constant<bool,
+            sizeof(F) <= InlineSize &&
+            alignof(F) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<F>::value> { };
+
+    template <typename F>
+    void construct(F&& func) {
+        using Type = typename std::decay<F>::type;
+        construct(std::forward<F>(func), IsInline<Type>());
+    }
+    template <typename F>
+    void construct(F&& func, std::true_type) {
+        using Type = typename std::decay<F>::type;
+        new (&storage_) Type(std::forward<F>(func));
+        ops_ = &InlineOps<Type>::ops;
+    }
+    template <typename F>
+    void construct(F&& func, std::false_type) {
+        using Type = typename std::decay<F>::type;
+        *reinterpret_cast<Type**>(&storage_) = new Type(std::forward<F>(func));
+        ops_ = &HeapOps<Type>::ops;
+    }
+    void reset() noexcept {
+        if (ops_ != nullptr) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    Storage storage_;
+    const Ops* ops_;
+};
+
+template <typename F>
+const Callback::Ops Callback::InlineOps<F>::ops = {
+        &Callback::InlineOps<F>::invoke,
+        &Callback::InlineOps<F>::move,
+        &Callback::InlineOps<F>::destroy
+};
+
+template <typename F>
+const Callback::Ops Callback::HeapOps<F>::ops = {
+        &Callback::HeapOps<F>::invoke,
+        &Callback::HeapOps<F>::move,
+        &Callback::HeapOps<F>::destroy
+};
+
+#endif //TIMER_CALLBACK_H
@@ -0,0 +1,49 @@
+#include "timer_clock.h"
+
+#include <mutex>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+TscCalibration TscClockPolicy::calibration_{false, 0, 0, 0};
+std::atomic_bool TscClockPolicy::usable_(false);
+
+void TscClockPolicy::init() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        calibration_ = calibrateTsc();
+        usable_.store(calibration_.usable, std::memory_order_release);
+    });
+}
+
+TscCalibration calibrateTsc() {
+    TscCalibration calibration{false, 0, 0, 0};
+#if defined(__x86_64__) || defined(__i386__)
+    // Invariant TSC: constant rate in all P/C states. (CPUID 0x80000007 EDX bit 8)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007 ||
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0 || (edx & (1u << 8)) == 0) {
+        return calibration;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t begin_tsc = __rdtsc();
+    auto end = begin;
+    uint64_t end_tsc = begin_tsc;
+    const int calibrate_ms = TscClockPolicy::CalibrateMs;
+    while (end - begin < std::chrono::milliseconds(calibrate_ms)) {
+        end = std::chrono::steady_clock::now();
+        end_tsc = __rdtsc();
+    }
+    auto elapse = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    if (end_tsc <= begin_tsc) {
+        return calibration;
+    }
+    calibration.usable = true;
+    calibration.base_tsc = end_tsc;
+    calibration.base_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            end.time_since_epoch()).count();
+    calibration.ns_per_tick = static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(elapse) << 32) / (end_tsc - begin_tsc));
+#endif
+    return calibration;
+}
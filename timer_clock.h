@@ -0,0 +1,134 @@
+#ifndef TIMER_CLOCK_H
+#define TIMER_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Clock policies of BasicManagerTimer. Time points are always of steady
+// clock (CLOCK_MONOTONIC), a policy only decides how it's read.
+//  init(): one time setup, called by manager constructor.
+//  now(): hot path, stats & absolute time of jobs. May be coarse or stale.
+//  submit(): base of relative expirations (addJobRunAfter etc.), a job
+//  fires early by how much it lags behind.
+//  wakeup(): loop wake up & spin, once per wakeup. Must be precise.
+
+// std::chrono::steady_clock. (Default)
+struct SteadyClockPolicy {
+    using TimePoint = std::chrono::steady_clock::time_point;
+    static void init() { }
+    static TimePoint now() {
+        return std::chrono::steady_clock::now();
+    }
+    static TimePoint submit() {
+        return now();
+    }
+    static TimePoint wakeup() {
+        return now();
+    }
+};
+
+// CLOCK_MONOTONIC_COARSE, a vDSO memory read without TSC access.
+// Resolution is one kernel tick (1 - 4ms), jobs may fire early by it.
+struct CoarseClockPolicy {
+    using TimePoint = std::chrono::steady_clock::time_point;
+    static void init() { }
+    static TimePoint now() {
+#ifdef CLOCK_MONOTONIC_COARSE
+        struct timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return TimePoint(std::chrono::duration_cast<TimePoint::duration>(
+                std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#else
+        return std::chrono::steady_clock::now();
+#endif
+    }
+    static TimePoint submit() {
+        return now();
+    }
+    static TimePoint wakeup() {
+        return std::chrono::steady_clock::now();
+    }
+};
+
+// TSC calibrated against steady clock once. Falls back to steady clock
+// if TSC is not invariant (or not x86).
+struct TscCalibration {
+    bool usable;
+    uint64_t base_tsc;
+    int64_t base_ns;
+    uint64_t ns_per_tick; // Fixed point, 32 fraction bits
+};
+
+// Spin CalibrateMs against steady clock. (Called once)
+TscCalibration calibrateTsc();
+
+// rdtsc & one multiply. Drift from CLOCK_MONOTONIC (NTP slew) is not
+// corrected, it's small for timeouts but grows with uptime, so wakeup()
+// reads steady clock. Steady clock is used until init() calibrates.
+struct TscClockPolicy {
+    using TimePoint = std::chrono::steady_clock::time_point;
+    static const int CalibrateMs = 10;
+    // Spin CalibrateMs once per process, later calls return at once.
+    static void init();
+    static TimePoint now() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (usable_.load(std::memory_order_acquire)) {
+            // Signed, TSC of another core may be a bit behind base_tsc.
+            auto ticks = static_cast<__int128>(
+                    static_cast<int64_t>(__rdtsc() - calibration_.base_tsc));
+            auto ns = static_cast<int64_t>((ticks * calibration_.ns_per_tick) >> 32);
+            return TimePoint(std::chrono::nanoseconds(calibration_.base_ns + ns));
+        }
+#endif
+        return std::chrono::steady_clock::now();
+    }
+    static TimePoint submit() {
+        return now();
+    }
+    static TimePoint wakeup() {
+        return std::chrono::steady_clock::now();
+    }
+
+private:
+    // Written once by init() before usable_ is set.
+    static TscCalibration calibration_;
+    static std::atomic_bool usable_;
+};
+
+// Time read by the latest loop wakeup of any manager using it, now() is
+// one atomic load. Time stands still while loops sleep, so stats read then
+// are off by the sleep time. Use it when loop wakes often (e.g. a repeat
+// job every millisecond) and stats allow that error. Relative expirations
+// read Source, they don't fire early.
+template <typename Source = SteadyClockPolicy>
+struct CachedClockPolicy {
+    using TimePoint = std::chrono::steady_clock::time_point;
+    static void init() {
+        Source::init();
+        cached();
+    }
+    static TimePoint now() {
+        return TimePoint(TimePoint::duration(cached().load(std::memory_order_relaxed)));
+    }
+    static TimePoint submit() {
+        return Source::submit();
+    }
+    static TimePoint wakeup() {
+        auto time = Source::wakeup();
+        cached().store(time.time_since_epoch().count(), std::memory_order_relaxed);
+        return time;
+    }
+
+private:
+    static std::atomic<TimePoint::rep>& cached() {
+        static std::atomic<TimePoint::rep> time(Source::wakeup().time_since_epoch().count());
+        return time;
+    }
+};
+
+#endif //TIMER_CLOCK_H
@@ -0,0 +1,507 @@
+#include "timer_cron.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+
+static const int64_t DaySeconds = 86400;
+static const int64_t YearSeconds = 365 * DaySeconds;
+
+static int64_t floorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b < 0 ? 1 : 0);
+}
+
+// Days since 1970-01-01 of a civil date, and the reverse.
+// (Algorithms of http://howardhinnant.github.io/date_algorithms.html)
+static int64_t daysFromCivil(int64_t year, unsigned int month, unsigned int day) {
+    year -= month <= 2 ? 1 : 0;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    auto yoe = static_cast<unsigned int>(year - era * 400);
+    unsigned int doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t& year, unsigned int& month, unsigned int& day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    auto doe = static_cast<unsigned int>(days - era * 146097);
+    unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned int mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+// 0 is Sunday.
+static unsigned int weekdayOf(int64_t days) {
+    return static_cast<unsigned int>(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+}
+
+static unsigned int daysInMonth(int64_t year, unsigned int month) {
+    if (month == 2) {
+        bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+        return leap ? 29 : 28;
+    }
+    return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+}
+
+// First set bit not lower than 'from', -1 if none.
+static int nextBit(uint64_t mask, int from) {
+    uint64_t rest = from < 64 ? mask >> from : 0;
+    return rest == 0 ? -1 : from + __builtin_ctzll(rest);
+}
+
+TimeZone::TimeZone(int32_t offset, std::vector<Transition> transitions) :
+        first_offset_(offset),
+        transitions_(std::move(transitions)) {
+    std::sort(transitions_.begin(), transitions_.end(),
+            [](const Transition& a, const Transition& b) {
+        return a.utc < b.utc;
+    });
+}
+
+TimeZone::TimeZone() :
+        first_offset_(0),
+        years_(new Year[ProbedYears]) {
+    for (int i = 0; i < ProbedYears; ++i) {
+        years_[i].probed = false;
+    }
+}
+
+std::shared_ptr<const TimeZone> TimeZone::utc() {
+    static const std::shared_ptr<const TimeZone> zone = fixed(0);
+    return zone;
+}
+
+std::shared_ptr<const TimeZone> TimeZone::fixed(int32_t offset) {
+    return std::make_shared<TimeZone>(offset, std::vector<Transition>());
+}
+
+static int32_t localOffset(int64_t utc) {
+    auto c_time_t = static_cast<time_t>(utc);
+    struct tm calendar{};
+    if (nullptr == localtime_r(&c_time_t, &calendar)) {
+        return 0;
+    }
+    return static_cast<int32_t>(calendar.tm_gmtoff);
+}
+
+// Offset changes in [begin, end), a change at 'begin' is included.
+static void probeYear(int64_t begin, int64_t end, int32_t& first,
+        TimeZone::Transition* transitions, uint32_t& count, uint32_t max) {
+    // Zones change at most twice a year, check every 12 hours then find
+    // the exact second by binary search.
+    const int64_t step = DaySeconds / 2;
+    first = localOffset(begin);
+    count = 0;
+    int32_t offset = localOffset(begin - 1);
+    int64_t last = begin - 1;
+    for (int64_t t = begin; last < end - 1; t = std::min(t + step, end - 1)) {
+        int32_t next = localOffset(t);
+        if (next != offset) {
+            int64_t low = last;
+            int64_t high = t;
+            while (high - low > 1) {
+                int64_t mid = low + (high - low) / 2;
+                if (localOffset(mid) == offset) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            if (count < max) {
+                transitions[count++] = TimeZone::Transition{high, next};
+            }
+            offset = next;
+        }
+        last = t;
+    }
+}
+
+std::shared_ptr<const TimeZone> TimeZone::local() {
+    // Created once, thread safe by static initialization.
+    static const std::shared_ptr<const TimeZone> zone(new TimeZone());
+    return zone;
+}
+
+const TimeZone::Year& TimeZone::yearOf(int64_t utc) const {
+    int64_t index = std::min(std::max(floorDiv(utc, YearSeconds), int64_t(0)),
+            int64_t(ProbedYears - 1));
+    Year& year = years_[index];
+    if (!year.probed.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(probe_mutex_);
+        if (!year.probed.load(std::memory_order_relaxed)) {
+            probeYear(index * YearSeconds, (index + 1) * YearSeconds, year.offset,
+                    year.transitions, year.count, MaxYearTransitions);
+            year.probed.store(true, std::memory_order_release);
+        }
+    }
+    return year;
+}
+
+int32_t TimeZone::offsetAt(int64_t utc) const {
+    if (years_ != nullptr) {
+        const Year& year = yearOf(utc);
+        int32_t offset = year.offset;
+        for (uint32_t i = 0; i < year.count && year.transitions[i].utc <= utc; ++i) {
+            offset = year.transitions[i].offset;
+        }
+        return offset;
+    }
+    auto iter = std::upper_bound(transitions_.begin(), transitions_.end(), utc,
+            [](int64_t time, const Transition& transition) {
+        return time < transition.utc;
+    });
+    return iter == transitions_.begin() ? first_offset_ : (iter - 1)->offset;
+}
+
+int64_t TimeZone::nextTransition(int64_t from, int64_t to) const {
+    if (years_ != nullptr) {
+        int64_t last = std::min(floorDiv(to, YearSeconds), int64_t(ProbedYears - 1));
+        for (int64_t index = std::max(floorDiv(from, YearSeconds), int64_t(0));
+                index <= last; ++index) {
+            const Year& year = yearOf(index * YearSeconds);
+            for (uint32_t i = 0; i < year.count; ++i) {
+                int64_t utc = year.transitions[i].utc;
+                if (utc > from) {
+                    return utc <= to ? utc : INT64_MAX;
+                }
+            }
+        }
+        return INT64_MAX;
+    }
+    auto iter = std::upper_bound(transitions_.begin(), transitions_.end(), from,
+            [](int64_t time, const Transition& transition) {
+        return time < transition.utc;
+    });
+    return iter != transitions_.end() && iter->utc <= to ? iter->utc : INT64_MAX;
+}
+
+int64_t TimeZone::toUtc(int64_t local, int64_t after) const {
+    // Offsets before & after a change near 'local'. Zone changes at most
+    // once a day.
+    int32_t before = offsetAt(local - DaySeconds);
+    int32_t later = offsetAt(local + DaySeconds);
+    int64_t candidates[2] = {local - before, local - later};
+    if (candidates[0] > candidates[1]) {
+        std::swap(candidates[0], candidates[1]);
+    }
+    for (int64_t utc : candidates) {
+        if (utc > after && utc + offsetAt(utc) == local) {
+            return utc;
+        }
+    }
+    // Skipped by DST, fire after the gap.
+    return local - std::min(before, later);
+}
+
+static const char* const MonthNames[] = {
+        "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+        "JUL", "AUG", "SEP", "OCT", "NOV", "DEC", nullptr};
+static const char* const DayNames[] = {
+        "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT", nullptr};
+
+// Number or name, names[i] is 'base' + i.
+static bool parseValue(const std::string& text, int min, int max,
+        const char* const* names, int base, int& value) {
+    if (text.empty()) {
+        return false;
+    }
+    if (isdigit(static_cast<unsigned char>(text[0]))) {
+        char* end = nullptr;
+        long number = strtol(text.c_str(), &end, 10);
+        if (*end != '\0' || number < min || number > max) {
+            return false;
+        }
+        value = static_cast<int>(number);
+        return true;
+    }
+    for (int i = 0; names != nullptr && names[i] != nullptr; ++i) {
+        if (strcasecmp(text.c_str(), names[i]) == 0) {
+            value = base + i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseField(const std::string& field, int min, int max,
+        const char* const* names, int base, uint64_t& mask) {
+    mask = 0;
+    size_t begin = 0;
+    while (begin <= field.size()) {
+        size_t end = std::min(field.find(',', begin), field.size());
+        std::string item = field.substr(begin, end - begin);
+        begin = end + 1;
+        int step = 1;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            if (!parseValue(item.substr(slash + 1), 1, max - min + 1, nullptr, 0, step)) {
+                return false;
+            }
+            item.resize(slash);
+        }
+        int low = min;
+        int high = max;
+        size_t dash = item.find('-');
+        if (item == "*" || item == "?") {
+            // Whole range.
+        } else if (dash != std::string::npos) {
+            if (!parseValue(item.substr(0, dash), min, max, names, base, low) ||
+                !parseValue(item.substr(dash + 1), min, max, names, base, high) ||
+                low > high) {
+                return false;
+            }
+        } else {
+            if (!parseValue(item, min, max, names, base, low)) {
+                return false;
+            }
+            // "n/s" is from n to max.
+            high = slash == std::string::npos ? low : max;
+        }
+        for (int value = low; value <= high; value += step) {
+            mask |= 1ULL << value;
+        }
+    }
+    return mask != 0;
+}
+
+CronSchedule::CronSchedule() :
+        seconds_(0),
+        minutes_(0),
+        hours_(0),
+        days_(0),
+        months_(0),
+        weekdays_(0),
+        any_day_(true),
+        any_weekday_(true),
+        any_hour_(false) { }
+
+std::shared_ptr<const CronSchedule> CronSchedule::parse(const std::string& expression,
+        std::shared_ptr<const TimeZone> zone, char* err) {
+    std::shared_ptr<CronSchedule> schedule(new CronSchedule());
+    schedule->zone_ = zone != nullptr ? std::move(zone) : TimeZone::local();
+    if (!schedule->parseFields(expression, err)) {
+        return nullptr;
+    }
+    return schedule;
+}
+
+std::shared_ptr<const CronSchedule> CronSchedule::at(int hour, int min, int sec,
+        std::shared_ptr<const TimeZone> zone) {
+    if (hour > 23 || min > 59 || sec < 0 || sec > 59) {
+        return nullptr;
+    }
+    std::shared_ptr<CronSchedule> schedule(new CronSchedule());
+    schedule->zone_ = zone != nullptr ? std::move(zone) : TimeZone::local();
+    schedule->seconds_ = 1ULL << sec;
+    schedule->minutes_ = min < 0 ? (1ULL << 60) - 1 : 1ULL << min;
+    schedule->hours_ = hour < 0 ? (1U << 24) - 1 : 1U << hour;
+    schedule->any_hour_ = hour < 0;
+    schedule->days_ = ~1U;
+    schedule->months_ = 0x1FFE;
+    schedule->weekdays_ = 0x7F;
+    return schedule;
+}
+
+bool CronSchedule::parseFields(const std::string& expression, char* err) {
+    std::vector<std::string> fields;
+    size_t pos = 0;
+    while (pos < expression.size()) {
+        if (isspace(static_cast<unsigned char>(expression[pos]))) {
+            ++pos;
+            continue;
+        }
+        size_t end = pos;
+        while (end < expression.size() && !isspace(static_cast<unsigned char>(expression[end]))) {
+            ++end;
+        }
+        fields.push_back(expression.substr(pos, end - pos));
+        pos = end;
+    }
+    if (fields.size() == 1 && fields[0][0] == '@') {
+        static const char* const Macros[][2] = {
+                {"@yearly", "0 0 0 1 1 *"}, {"@annually", "0 0 0 1 1 *"},
+                {"@monthly", "0 0 0 1 * *"}, {"@weekly", "0 0 0 * * 0"},
+                {"@daily", "0 0 0 * * *"}, {"@midnight", "0 0 0 * * *"},
+                {"@hourly", "0 0 * * * *"}};
+        for (auto& macro : Macros) {
+            if (fields[0] == macro[0]) {
+                return parseFields(macro[1], err);
+            }
+        }
+    }
+    if (fields.size() == 5) {
+        fields.insert(fields.begin(), "0");
+    }
+    if (fields.size() != 6) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Cron expression needs 5 or 6 fields: '%s'.", expression.c_str());
+        }
+        return false;
+    }
+    uint64_t masks[6];
+    const int mins[6] = {0, 0, 0, 1, 1, 0};
+    const int maxs[6] = {59, 59, 23, 31, 12, 7};
+    const char* const* names[6] = {nullptr, nullptr, nullptr, nullptr, MonthNames, DayNames};
+    const int bases[6] = {0, 0, 0, 0, 1, 0};
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (!parseField(fields[i], mins[i], maxs[i], names[i], bases[i], masks[i])) {
+            if (err != nullptr) {
+                snprintf(err, 1024, "Bad cron field '%s'.", fields[i].c_str());
+            }
+            return false;
+        }
+    }
+    seconds_ = masks[0];
+    minutes_ = masks[1];
+    hours_ = static_cast<uint32_t>(masks[2]);
+    days_ = static_cast<uint32_t>(masks[3]);
+    months_ = static_cast<uint16_t>(masks[4]);
+    // Sunday is 0 or 7.
+    weekdays_ = static_cast<uint8_t>((masks[5] | masks[5] >> 7) & 0x7F);
+    // Field starting with '*' (e.g. */2) is unrestricted for OR, as cron.
+    any_day_ = fields[3][0] == '*' || fields[3] == "?";
+    any_weekday_ = fields[5][0] == '*' || fields[5] == "?";
+    any_hour_ = hours_ == (1U << 24) - 1;
+    return true;
+}
+
+bool CronSchedule::matchDay(int64_t days, unsigned int day) const {
+    bool day_match = (days_ >> day & 1) != 0;
+    bool weekday_match = (weekdays_ >> weekdayOf(days) & 1) != 0;
+    if (any_day_ || any_weekday_) {
+        return day_match && weekday_match;
+    }
+    return day_match || weekday_match;
+}
+
+int64_t CronSchedule::nextLocal(int64_t local) const {
+    int64_t days = floorDiv(local, DaySeconds);
+    auto sod = static_cast<int>(local - days * DaySeconds);
+    int64_t year;
+    unsigned int month;
+    unsigned int day;
+    civilFromDays(days, year, month, day);
+    int hour = sod / 3600;
+    int min = sod / 60 % 60;
+    int sec = sod % 60;
+    // Feb 29 may be 8 years later.
+    int64_t last_year = year + 9;
+    while (year <= last_year) {
+        if ((months_ >> month & 1) == 0 || day > daysInMonth(year, month)) {
+            if (++month > 12) {
+                month = 1;
+                ++year;
+            }
+            day = 1;
+            hour = min = sec = 0;
+            continue;
+        }
+        days = daysFromCivil(year, month, day);
+        int next = matchDay(days, day) ? nextBit(hours_, hour) : -1;
+        if (next < 0) {
+            ++day;
+            hour = min = sec = 0;
+            continue;
+        }
+        if (next != hour) {
+            hour = next;
+            min = sec = 0;
+        }
+        next = nextBit(minutes_, min);
+        if (next < 0) {
+            ++hour;
+            min = sec = 0;
+            continue;
+        }
+        if (next != min) {
+            min = next;
+            sec = 0;
+        }
+        next = nextBit(seconds_, sec);
+        if (next < 0) {
+            ++min;
+            sec = 0;
+            continue;
+        }
+        return days * DaySeconds + hour * 3600 + min * 60 + next;
+    }
+    return NoTime;
+}
+
+int64_t CronSchedule::nextElapsed(int64_t utc) const {
+    // Match wall clock of the current offset, start over from the offset
+    // change if one comes first.
+    while (true) {
+        int32_t offset = zone_->offsetAt(utc + 1);
+        int64_t local = nextLocal(utc + 1 + offset);
+        if (local == NoTime) {
+            return NoTime;
+        }
+        int64_t fire = local - offset;
+        int64_t change = zone_->nextTransition(utc + 1, fire);
+        if (change == INT64_MAX) {
+            return fire;
+        }
+        utc = change - 1;
+    }
+}
+
+size_t CronSchedule::nextTimes(const SysClock::time_point& after, size_t count,
+        SysClock::time_point* times) const {
+    int64_t utc = floorDiv(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            after.time_since_epoch()).count(), 1000000000);
+    size_t filled = 0;
+    if (any_hour_) {
+        while (filled < count && (utc = nextElapsed(utc)) != NoTime) {
+            times[filled++] = SysClock::time_point(std::chrono::duration_cast<SysClock::duration>(
+                    std::chrono::seconds(utc)));
+        }
+        return filled;
+    }
+    int64_t local = utc + zone_->offsetAt(utc) + 1;
+    while (filled < count) {
+        local = nextLocal(local);
+        if (local == NoTime) {
+            break;
+        }
+        int64_t fire = zone_->toUtc(local, utc);
+        ++local;
+        if (fire <= utc) {
+            // Local time repeated by DST, it has fired already.
+            continue;
+        }
+        times[filled++] = SysClock::time_point(std::chrono::duration_cast<SysClock::duration>(
+                std::chrono::seconds(fire)));
+        utc = fire;
+    }
+    return filled;
+}
+
+CronSchedule::SysClock::time_point CronSchedule::next(const SysClock::time_point& after) const {
+    SysClock::time_point time;
+    return nextTimes(after, 1, &time) == 1 ? time : SysClock::time_point::max();
+}
+
+CronSchedule::SysClock::time_point CronJob::next(CronSchedule::SysClock::time_point after) {
+    after = std::max(after, last_);
+    while (pos_ < size_ && times_[pos_] <= after) {
+        ++pos_;
+    }
+    if (pos_ == size_) {
+        size_ = schedule_->nextTimes(after, BatchSize, times_);
+        pos_ = 0;
+        if (size_ == 0) {
+            return CronSchedule::SysClock::time_point::max();
+        }
+    }
+    last_ = times_[pos_++];
+    return last_;
+}
@@ -0,0 +1,139 @@
+#ifndef TIMER_CRON_H
+#define TIMER_CRON_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// UTC offsets of a time zone as a transition table. Calendar math of cron
+// is table lookup & integer arithmetic, no libc tz call (glibc tz lock)
+// once the table covers the time.
+class TimeZone {
+public:
+    struct Transition {
+        int64_t utc; // Seconds since epoch the offset starts at
+        int32_t offset; // Seconds east of UTC
+    };
+
+    // 'offset' is used before the first transition.
+    TimeZone(int32_t offset, std::vector<Transition> transitions);
+    static std::shared_ptr<const TimeZone> utc();
+    static std::shared_ptr<const TimeZone> fixed(int32_t offset);
+    // Zone of localtime_r. Transitions of a year (365 days from epoch) are
+    // probed at first use of the year and cached, years 1970 to 2225.
+    static std::shared_ptr<const TimeZone> local();
+
+    int32_t offsetAt(int64_t utc) const;
+    // First transition later than 'from' & not later than 'to', INT64_MAX
+    // if none.
+    int64_t nextTransition(int64_t from, int64_t to) const;
+    // Earliest UTC time later than 'after' showing 'local' wall clock.
+    // Local time skipped by DST is moved forward by the gap.
+    int64_t toUtc(int64_t local, int64_t after) const;
+
+    static const int ProbedYears = 256;
+    // A year holding more transitions keeps the first ones.
+    static const int MaxYearTransitions = 8;
+
+private:
+    struct Year {
+        std::atomic_bool probed;
+        int32_t offset; // Offset at start of year
+        uint32_t count;
+        Transition transitions[MaxYearTransitions];
+    };
+
+    TimeZone();
+    // Probed on first use, time out of range uses the first or last year.
+    const Year& yearOf(int64_t utc) const;
+
+    int32_t first_offset_;
+    std::vector<Transition> transitions_;
+    // Local zone only.
+    std::unique_ptr<Year[]> years_;
+    mutable std::mutex probe_mutex_;
+};
+
+// Cron expression "[sec] min hour day-of-month month day-of-week", 5 or 6
+// fields, or @yearly @monthly @weekly @daily @hourly.
+// Field is '*', '?', n, a-b, */s, a-b/s, n/s or a list of them by ','.
+// Month JAN-DEC & week day SUN-SAT names are accepted, Sunday is 0 or 7.
+// If both day fields are restricted, a day matching either fires (cron).
+// A day field starting with '*' (e.g. */2) is not restricted, then a day
+// must match both.
+// Times are wall clock of zone: a time skipped by DST fires after the
+// gap, a time repeated by DST fires once. If hour field is every hour,
+// job follows elapsed time instead: times of the repeated hour fire
+// again, times skipped don't fire.
+class CronSchedule {
+public:
+    using SysClock = std::chrono::system_clock;
+
+    // Return nullptr if expression is invalid.
+    static std::shared_ptr<const CronSchedule> parse(const std::string& expression,
+            std::shared_ptr<const TimeZone> zone = TimeZone::local(),
+            char* err = nullptr);
+    // Every day at hour:min:sec, -1 is every hour (minute).
+    static std::shared_ptr<const CronSchedule> at(int hour, int min, int sec,
+            std::shared_ptr<const TimeZone> zone = TimeZone::local());
+
+    // Fill at most 'count' fire times later than 'after' in order.
+    // Return count filled, less if schedule ends (e.g. Feb 30).
+    size_t nextTimes(const SysClock::time_point& after, size_t count,
+            SysClock::time_point* times) const;
+    // Return time_point::max() if never fires.
+    SysClock::time_point next(const SysClock::time_point& after) const;
+
+private:
+    static const int64_t NoTime = INT64_MIN;
+
+    CronSchedule();
+    bool parseFields(const std::string& expression, char* err);
+    bool matchDay(int64_t days, unsigned int day) const;
+    // First matching local time not earlier than 'local', NoTime if none.
+    int64_t nextLocal(int64_t local) const;
+    // First UTC time later than 'utc' whose wall clock matches, NoTime if
+    // none.
+    int64_t nextElapsed(int64_t utc) const;
+
+    uint64_t seconds_; // bit 0-59
+    uint64_t minutes_; // bit 0-59
+    uint32_t hours_; // bit 0-23
+    uint32_t days_; // bit 1-31
+    uint16_t months_; // bit 1-12
+    uint8_t weekdays_; // bit 0-6
+    bool any_day_;
+    bool any_weekday_;
+    bool any_hour_;
+    std::shared_ptr<const TimeZone> zone_;
+};
+
+// Upcoming fire times of one cron job, computed BatchSize at a time.
+// Used by loop thread & callback thread of the job, one at a time.
+class CronJob {
+public:
+    static const size_t BatchSize = 8;
+
+    explicit CronJob(std::shared_ptr<const CronSchedule> schedule) :
+            schedule_(std::move(schedule)),
+            last_(CronSchedule::SysClock::time_point::min()),
+            pos_(0),
+            size_(0) { }
+    // First fire time later than 'after' & the last one returned.
+    // Missed fire times are skipped. Return time_point::max() if none.
+    CronSchedule::SysClock::time_point next(CronSchedule::SysClock::time_point after);
+
+private:
+    std::shared_ptr<const CronSchedule> schedule_;
+    CronSchedule::SysClock::time_point last_;
+    CronSchedule::SysClock::time_point times_[BatchSize];
+    size_t pos_;
+    size_t size_;
+};
+
+#endif //TIMER_CRON_H
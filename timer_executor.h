@@ -0,0 +1,47 @@
+#ifndef TIMER_EXECUTOR_H
+#define TIMER_EXECUTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "timer_callback.h"
+
+// Priority class of a timer. Smaller runs first.
+enum class TimerPriority : uint8_t {
+    High,
+    Normal,
+    Low
+};
+
+// Order of a dispatched callback: priority class, then earliest
+// expiration of its timer. (EDF)
+struct TaskOrder {
+    TimerPriority priority;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Where ManagerTimer dispatches expired callbacks. No future is created,
+// callback may be run by any thread of executor.
+class TimerExecutor {
+public:
+    virtual ~TimerExecutor() = default;
+    virtual void execute(Callback task) = 0;
+    // Take all tasks of a burst, tasks is empty after. Executor can
+    // override it to queue them under one lock.
+    virtual void executeBatch(std::vector<Callback>& tasks) {
+        for (auto& task : tasks) {
+            execute(std::move(task));
+        }
+        tasks.clear();
+    }
+    // orders[i] is order of tasks[i]. Executor without priority queue
+    // ignores them.
+    virtual void executeOrdered(std::vector<Callback>& tasks,
+            const std::vector<TaskOrder>& orders) {
+        (void)orders;
+        executeBatch(tasks);
+    }
+};
+
+#endif //TIMER_EXECUTOR_H
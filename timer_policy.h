@@ -0,0 +1,67 @@
+#ifndef TIMER_POLICY_H
+#define TIMER_POLICY_H
+
+#include <chrono>
+
+#include "timer_clock.h"
+#include "timer_storage.h"
+
+// Policies of BasicManagerTimer, picked at compile time.
+
+// Clock policies are in timer_clock.h.
+
+// Dispatch policy: where callbacks may be run besides loop thread.
+// Pool: ThreadPool. Executor: TimerExecutor. Ways set false are constant
+// branches, the compiler drops them.
+// Decided at runtime by setThreadPool() / setExecutor(). (Default)
+struct DynamicDispatch {
+    static const bool Pool = true;
+    static const bool Executor = true;
+};
+
+// Always in loop thread, thread pool & executor are ignored.
+struct InlineDispatch {
+    static const bool Pool = false;
+    static const bool Executor = false;
+};
+
+// Thread pool only, in loop thread if thread pool is not set.
+struct PoolDispatch {
+    static const bool Pool = true;
+    static const bool Executor = false;
+};
+
+// Executor only, in loop thread if executor is not set.
+struct ExecutorDispatch {
+    static const bool Pool = false;
+    static const bool Executor = true;
+};
+
+// Storage policy: a TimerStorage subclass. Final classes are called
+// without virtual dispatch. StorageMaker builds the initial storage.
+template <typename Storage>
+struct StorageMaker {
+    static Storage* make(const TimerStorage::TimePoint& origin) {
+        (void)origin;
+        return new Storage();
+    }
+};
+
+// Runtime choice, map until setTimingWheel(). (Default)
+template <>
+struct StorageMaker<TimerStorage> {
+    static TimerStorage* make(const TimerStorage::TimePoint& origin) {
+        (void)origin;
+        return new TimerMapStorage();
+    }
+};
+
+// 1ms tick & 4 levels (about 4.6 hours in wheel), setTimingWheel() to change.
+template <>
+struct StorageMaker<TimingWheelStorage> {
+    static TimingWheelStorage* make(const TimerStorage::TimePoint& origin) {
+        return new TimingWheelStorage(std::chrono::milliseconds(1), 4, origin);
+    }
+};
+
+#endif //TIMER_POLICY_H
@@ -0,0 +1,167 @@
+#include "timer_pool.h"
+
+// Blocks moved between thread cache & free list at once.
+static const size_t CacheBatch = 32;
+static const size_t CacheSlots = 4;
+
+static std::atomic<uint64_t> next_pool_id(1);
+
+// Free blocks of one pool cached by a thread. Trivially destructible, no
+// guard on the fast path.
+struct TimerNodePool::CacheSlot {
+    uint64_t pool_id;
+    FreeBlock* list;
+    size_t count;
+};
+
+static thread_local bool cache_destroyed = false;
+
+// Owners of cache slots, blocks are given back when thread exits. Pool is
+// referenced weakly, blocks of a destroyed pool are dropped untouched.
+struct TimerNodePool::ThreadCache {
+    ~ThreadCache() {
+        for (size_t i = 0; i < CacheSlots; ++i) {
+            flush(i);
+        }
+        cache_destroyed = true;
+    }
+
+    void flush(size_t i) {
+        auto pool = owners[i].lock();
+        if (pool != nullptr && slots[i].count != 0) {
+            pool->give(slots[i].list, slots[i].count);
+        }
+        owners[i].reset();
+        slots[i] = CacheSlot{0, nullptr, 0};
+    }
+
+    static thread_local CacheSlot slots[CacheSlots];
+    std::weak_ptr<TimerNodePool> owners[CacheSlots];
+};
+
+thread_local TimerNodePool::CacheSlot TimerNodePool::ThreadCache::slots[CacheSlots];
+
+TimerNodePool::TimerNodePool(size_t blocks_per_slab) :
+        blocks_per_slab_(blocks_per_slab == 0 ? 1 : blocks_per_slab),
+        id_(next_pool_id++),
+        block_size_(0),
+        free_list_(nullptr) { }
+
+TimerNodePool::~TimerNodePool() {
+    for (void* slab : slabs_) {
+        ::operator delete(slab);
+    }
+}
+
+void* TimerNodePool::allocate(size_t size) {
+    if (!isBlock(size)) {
+        return ::operator new(size);
+    }
+    CacheSlot* slot = cacheSlot();
+    if (slot == nullptr) {
+        FreeBlock* block = nullptr;
+        take(block, 1);
+        return block;
+    }
+    if (slot->list == nullptr) {
+        slot->count = take(slot->list, CacheBatch);
+    }
+    FreeBlock* block = slot->list;
+    slot->list = block->next;
+    --slot->count;
+    return block;
+}
+
+void TimerNodePool::deallocate(void* block, size_t size) {
+    if (!isBlock(size)) {
+        ::operator delete(block);
+        return;
+    }
+    auto free_block = static_cast<FreeBlock*>(block);
+    CacheSlot* slot = cacheSlot();
+    if (slot == nullptr) {
+        free_block->next = nullptr;
+        give(free_block, 1);
+        return;
+    }
+    free_block->next = slot->list;
+    slot->list = free_block;
+    if (++slot->count < CacheBatch * 2) {
+        return;
+    }
+    // Thread frees more than it allocates (e.g. loop thread), keep a batch
+    // for reuse and give the rest back.
+    FreeBlock* last = slot->list;
+    for (size_t i = 1; i < CacheBatch; ++i) {
+        last = last->next;
+    }
+    give(last->next, slot->count - CacheBatch);
+    last->next = nullptr;
+    slot->count = CacheBatch;
+}
+
+bool TimerNodePool::isBlock(size_t size) {
+    // Keep blocks aligned as operator new does.
+    const size_t align = alignof(std::max_align_t);
+    size_t block_size = (size + align - 1) / align * align;
+    size_t current = block_size_.load(std::memory_order_relaxed);
+    if (current == 0 && block_size_.compare_exchange_strong(current, block_size)) {
+        return true;
+    }
+    return current == block_size;
+}
+
+TimerNodePool::CacheSlot* TimerNodePool::cacheSlot() {
+    size_t i = id_ % CacheSlots;
+    CacheSlot* slot = &ThreadCache::slots[i];
+    if (slot->pool_id == id_) {
+        return slot;
+    }
+    if (cache_destroyed) {
+        return nullptr;
+    }
+    // Slot is taken by another pool or unused.
+    static thread_local ThreadCache cache;
+    cache.flush(i);
+    cache.owners[i] = shared_from_this();
+    slot->pool_id = id_;
+    return slot;
+}
+
+size_t TimerNodePool::take(FreeBlock*& list, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_list_ == nullptr) {
+        grow();
+    }
+    size_t taken = 1;
+    FreeBlock* last = free_list_;
+    while (taken < count && last->next != nullptr) {
+        last = last->next;
+        ++taken;
+    }
+    list = free_list_;
+    free_list_ = last->next;
+    last->next = nullptr;
+    return taken;
+}
+
+void TimerNodePool::give(FreeBlock* list, size_t count) {
+    FreeBlock* last = list;
+    for (size_t i = 1; i < count; ++i) {
+        last = last->next;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    last->next = free_list_;
+    free_list_ = list;
+}
+
+void TimerNodePool::grow() {
+    size_t block_size = block_size_;
+    auto slab = static_cast<char*>(::operator new(block_size * blocks_per_slab_));
+    slabs_.push_back(slab);
+    for (size_t i = blocks_per_slab_; i > 0; --i) {
+        auto block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * block_size);
+        block->next = free_list_;
+        free_list_ = block;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TIMER_POOL_H
+#define TIMER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Fixed size block pool. Blocks are carved from slabs and recycled by free
+// list, slabs are returned to system when pool is destroyed. Block size is
+// decided by the first allocation, other size fall back to operator new.
+// Thread safe, each thread caches a few free blocks so the shared free list
+// is locked once per batch. Pool must be owned by std::shared_ptr.
+class TimerNodePool : public std::enable_shared_from_this<TimerNodePool> {
+public:
+    explicit TimerNodePool(size_t blocks_per_slab = 256);
+    TimerNodePool(const TimerNodePool&) = delete;
+    TimerNodePool& operator= (const TimerNodePool&) = delete;
+    ~TimerNodePool();
+
+    void* allocate(size_t size);
+    void deallocate(void* block, size_t size);
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    struct CacheSlot;
+    struct ThreadCache;
+    // Return false if size is not the block size of pool.
+    bool isBlock(size_t size);
+    // Cached blocks of this pool in calling thread, nullptr while thread
+    // is exiting.
+    CacheSlot* cacheSlot();
+    // Move up to count blocks of free list to list, return number moved.
+    size_t take(FreeBlock*& list, size_t count);
+    // Put list of count blocks back to free list.
+    void give(FreeBlock* list, size_t count);
+    void grow();
+
+    const size_t blocks_per_slab_;
+    const uint64_t id_; // Never reused, tells thread caches apart
+    std::atomic<size_t> block_size_; // Set once by first allocation
+    std::mutex mutex_;
+    FreeBlock* free_list_; // Protect by mutex_
+    std::vector<void*> slabs_; // Protect by mutex_
+};
+
+// Allocator of node pool, for std::allocate_shared & containers.
+// Without pool, it is same as std::allocator.
+template <typename T>
+class PoolAllocator {
+    template <typename U>
+    friend class PoolAllocator;
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    explicit PoolAllocator(std::shared_ptr<TimerNodePool> pool) noexcept :
+            pool_(std::move(pool)) { }
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept :
+            pool_(other.pool_) { }
+
+    T* allocate(size_t n) {
+        if (n == 1 && pool_ != nullptr) {
+            return static_cast<T*>(pool_->allocate(sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        if (n == 1 && pool_ != nullptr) {
+            pool_->deallocate(p, sizeof(T));
+        } else {
+            ::operator delete(p);
+        }
+    }
+    template <typename U>
+    bool operator== (const PoolAllocator<U>& other) const noexcept {
+        return pool_ == other.pool_;
+    }
+    template <typename U>
+    bool operator!= (const PoolAllocator<U>& other) const noexcept {
+        return pool_ != other.pool_;
+    }
+
+private:
+    std::shared_ptr<TimerNodePool> pool_;
+};
+
+#endif //TIMER_POOL_H
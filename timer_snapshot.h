@@ -0,0 +1,445 @@
+#ifndef TIMER_SNAPSHOT_H
+#define TIMER_SNAPSHOT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "manager_timer.h"
+
+// Snapshot file: SnapshotHeader, then 'count' TimerRecord.
+// Host byte order, only read by the same build on the same architecture.
+struct SnapshotHeader {
+    static const uint32_t Version = 1;
+
+    char magic[8]; // "TMRSNAP"
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+
+struct TimerRecord {
+    // Wall clock nanoseconds since epoch, steady clock doesn't survive
+    // restart.
+    int64_t expiration;
+    // Nanoseconds, 0 is one shot.
+    int64_t period;
+    uint32_t callback_id;
+    uint32_t max_catch_up;
+    uint8_t repeat;
+    uint8_t missed_tick;
+    uint8_t priority;
+    uint8_t arg_size;
+    char arg[ManagerTimer::PersistentArgSize];
+};
+
+static_assert(sizeof(TimerRecord) == 64, "TimerRecord should be one cache line");
+
+// Callback of a persistent job. Snapshot finds persistent jobs by it.
+struct PersistentTask {
+    const ManagerTimer::PersistentCallback* func;
+    uint32_t id;
+    uint8_t size;
+    char arg[ManagerTimer::PersistentArgSize];
+    void operator()() {
+        (*func)(arg, size);
+    }
+};
+
+static_assert(sizeof(PersistentTask) <= Callback::InlineSize,
+        "PersistentTask should be stored inline");
+
+// Records of restore() not loaded yet, sorted by expiration. Records are
+// never changed, a snapshot may read them out of lock.
+struct RestoredJobs {
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock, Clock::duration>;
+
+    std::unique_ptr<TimerRecord[]> records;
+    uint64_t count;
+    uint64_t next; // First record not loaded, protect by map_mutex_
+    // Steady clock minus wall clock at restore.
+    std::chrono::nanoseconds offset;
+
+    TimePoint expirationOf(const TimerRecord& record) const {
+        return TimePoint(std::chrono::duration_cast<Clock::duration>(
+                std::chrono::nanoseconds(record.expiration) + offset));
+    }
+};
+
+static const char SnapshotMagic[8] = "TMRSNAP";
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::registerCallback(
+        uint32_t id, PersistentCallback func) {
+    if (!func) {
+        return false;
+    }
+    persistent_callbacks_[id].reset(new PersistentCallback(std::move(func)));
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addPersistentJobRunAt(
+        const TimePoint& expiration,
+        uint32_t id, const void* arg, size_t size) -> TimerPtr {
+    return addPersistentJob(TimerOptions(), expiration, Accuracy::zero(), id, arg, size);
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::addPersistentJob(
+        const TimerOptions& options,
+        const TimePoint& expiration, const Accuracy& period,
+        uint32_t id, const void* arg, size_t size) -> TimerPtr {
+    auto iter = persistent_callbacks_.find(id);
+    if (iter == persistent_callbacks_.end() || size > PersistentArgSize) {
+        return nullptr;
+    }
+    auto timer = makePersistentTimer(expiration, period, iter->second.get(), id, arg, size);
+    applyOptions(timer.get(), options);
+    addTimer(timer);
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::makePersistentTimer(
+        const TimePoint& expiration, const Accuracy& period,
+        const PersistentCallback* func, uint32_t id,
+        const void* arg, size_t size) -> TimerPtr {
+    TimerPtr timer;
+    if (period > Accuracy::zero()) {
+        timer = std::allocate_shared<Timer>(PoolAllocator<Timer>(node_pool_), expiration, period);
+    } else {
+        timer = std::allocate_shared<Timer>(PoolAllocator<Timer>(node_pool_), expiration);
+    }
+    PersistentTask task{func, id, static_cast<uint8_t>(size), {}};
+    if (size != 0) {
+        memcpy(task.arg, arg, size);
+    }
+    timer->cb_func_ = task;
+    timer->persistent_ = true;
+    return timer;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::snapshot(
+        const char* path, char* err) {
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    std::vector<TimerRecord> records;
+    auto steady_now = ClockPolicy::submit();
+    auto system_now = std::chrono::system_clock::now();
+    uint64_t stamp = ++snapshot_stamp_;
+    // Walk position in persistent list, moved forward chunk by chunk.
+    Timer marker(TimePoint::min());
+    std::vector<TimerPtr> dropped;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        if (lock_free_) {
+            // Storage is owned by loop thread.
+            if (running_ || loop_thread_.joinable()) {
+                if (err != nullptr) {
+                    snprintf(err, 1024, "Snapshot in lock free submit mode needs stopAndJoin().");
+                }
+                return false;
+            }
+            drainSubmitted(dropped);
+        }
+        marker.persistent_next_ = persistent_head_;
+        if (persistent_head_ != nullptr) {
+            persistent_head_->persistent_prev_ = &marker;
+        } else {
+            persistent_tail_ = &marker;
+        }
+        persistent_head_ = &marker;
+    }
+    releaseDropped(dropped);
+    // Producers & loop go on between chunks. A repeat timer added back
+    // behind the marker is stamped, it's saved once.
+    const size_t chunk = SnapshotChunk;
+    std::shared_ptr<RestoredJobs> restored;
+    uint64_t restored_from = 0;
+    for (bool done = false; !done; ) {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        Timer* timer = marker.persistent_next_;
+        for (size_t visited = 0; timer != nullptr && visited < chunk;
+             timer = timer->persistent_next_, ++visited) {
+            auto task = timer->cb_func_.target<PersistentTask>();
+            if (task == nullptr || timer->snapshot_stamp_ == stamp) {
+                continue;
+            }
+            timer->snapshot_stamp_ = stamp;
+            auto expiration = std::max(timer->expiration_, TimePoint(Accuracy(
+                    timer->extended_.load(std::memory_order_relaxed))));
+            TimerRecord record{};
+            record.expiration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    (system_now + (expiration - steady_now)).time_since_epoch()).count();
+            record.period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    timer->duration_).count();
+            record.callback_id = task->id;
+            record.max_catch_up = timer->max_catch_up_;
+            record.repeat = timer->repeat_ ? 1 : 0;
+            record.missed_tick = static_cast<uint8_t>(timer->missed_tick_);
+            record.priority = static_cast<uint8_t>(timer->priority_);
+            record.arg_size = task->size;
+            memcpy(record.arg, task->arg, task->size);
+            records.push_back(record);
+        }
+        unlinkPersistent(&marker);
+        if (timer == nullptr) {
+            // Jobs loaded from now on are not in the list walked.
+            restored = restored_;
+            restored_from = restored != nullptr ? restored->next : 0;
+            done = true;
+        } else {
+            marker.persistent_prev_ = timer->persistent_prev_;
+            marker.persistent_next_ = timer;
+            if (timer->persistent_prev_ != nullptr) {
+                timer->persistent_prev_->persistent_next_ = &marker;
+            } else {
+                persistent_head_ = &marker;
+            }
+            timer->persistent_prev_ = &marker;
+        }
+    }
+    // Restored jobs not loaded yet keep their wall clock expiration.
+    if (restored != nullptr) {
+        records.insert(records.end(), restored->records.get() + restored_from,
+                restored->records.get() + restored->count);
+    }
+    // Restore needs records in expiration order.
+    auto earlier = [](const TimerRecord& a, const TimerRecord& b) {
+        return a.expiration < b.expiration;
+    };
+    if (!std::is_sorted(records.begin(), records.end(), earlier)) {
+        std::stable_sort(records.begin(), records.end(), earlier);
+    }
+    SnapshotHeader header{};
+    memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version = SnapshotHeader::Version;
+    header.record_size = sizeof(TimerRecord);
+    header.count = records.size();
+    size_t file_size = sizeof(header) + records.size() * sizeof(TimerRecord);
+    // Write a temp file then rename, old snapshot is kept on failure.
+    std::string tmp_path = std::string(path) + ".tmp";
+    int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1 || ftruncate(fd, static_cast<off_t>(file_size)) == -1) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Create snapshot file failed. Errno: %d", errno);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+        return false;
+    }
+    void* data = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Map snapshot file failed. Errno: %d", errno);
+        }
+        close(fd);
+        return false;
+    }
+    memcpy(data, &header, sizeof(header));
+    if (!records.empty()) {
+        memcpy(static_cast<char*>(data) + sizeof(header), records.data(),
+                records.size() * sizeof(TimerRecord));
+    }
+    munmap(data, file_size);
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    ok = ok && rename(tmp_path.c_str(), path) == 0;
+    if (!ok && err != nullptr) {
+        snprintf(err, 1024, "Write snapshot file failed. Errno: %d", errno);
+    }
+    return ok;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+bool BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::restore(
+        const char* path, char* err) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat file_stat{};
+    if (fd == -1 || fstat(fd, &file_stat) == -1 ||
+        static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Open snapshot file failed. Errno: %d", errno);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+        return false;
+    }
+    auto file_size = static_cast<size_t>(file_stat.st_size);
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // Fault all pages in at once, every record is read.
+    flags |= MAP_POPULATE;
+#endif
+    void* data = mmap(nullptr, file_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Map snapshot file failed. Errno: %d", errno);
+        }
+        return false;
+    }
+    madvise(data, file_size, MADV_SEQUENTIAL);
+    const auto* header = static_cast<const SnapshotHeader*>(data);
+    if (memcmp(header->magic, SnapshotMagic, sizeof(header->magic)) != 0 ||
+        header->version != SnapshotHeader::Version ||
+        header->record_size != sizeof(TimerRecord) ||
+        header->count != (file_size - sizeof(SnapshotHeader)) / sizeof(TimerRecord) ||
+        (file_size - sizeof(SnapshotHeader)) % sizeof(TimerRecord) != 0) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Bad snapshot file.");
+        }
+        munmap(data, file_size);
+        return false;
+    }
+    const auto* records = reinterpret_cast<const TimerRecord*>(
+            static_cast<const char*>(data) + sizeof(SnapshotHeader));
+    auto count = header->count;
+    auto jobs = std::make_shared<RestoredJobs>();
+    jobs->records.reset(new TimerRecord[count]);
+    jobs->count = count;
+    jobs->next = 0;
+    jobs->offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            ClockPolicy::submit().time_since_epoch() -
+            std::chrono::system_clock::now().time_since_epoch());
+    bool sorted = true;
+    uint32_t func_id = 0;
+    bool func_found = false;
+    // Copy a cache sized chunk, then check it.
+    const uint64_t chunk = 1024;
+    for (uint64_t begin = 0; begin < count; begin += chunk) {
+        uint64_t end = std::min(count, begin + chunk);
+        memcpy(&jobs->records[begin], records + begin, (end - begin) * sizeof(TimerRecord));
+        for (uint64_t i = begin; i < end; ++i) {
+            const TimerRecord& record = jobs->records[i];
+            // Enums index stats arrays, a corrupt or foreign file is rejected.
+            if (record.arg_size > PersistentArgSize ||
+                record.missed_tick > static_cast<uint8_t>(MissedTick::FixedDelay) ||
+                record.priority >= TimerStats::PriorityNum) {
+                if (err != nullptr) {
+                    snprintf(err, 1024, "Bad record %llu of snapshot.",
+                            static_cast<unsigned long long>(i));
+                }
+                munmap(data, file_size);
+                return false;
+            }
+            // Records of the same callback usually come together.
+            if (!func_found || func_id != record.callback_id) {
+                if (persistent_callbacks_.count(record.callback_id) == 0) {
+                    if (err != nullptr) {
+                        snprintf(err, 1024, "Callback %u of snapshot is not registered.",
+                                record.callback_id);
+                    }
+                    munmap(data, file_size);
+                    return false;
+                }
+                func_id = record.callback_id;
+                func_found = true;
+            }
+            if (i != 0 && record.expiration < jobs->records[i - 1].expiration) {
+                sorted = false;
+            }
+        }
+    }
+    munmap(data, file_size);
+    // Snapshot writes records sorted, loop loads them in order.
+    if (!sorted) {
+        std::stable_sort(jobs->records.get(), jobs->records.get() + count,
+                [](const TimerRecord& a, const TimerRecord& b) {
+            return a.expiration < b.expiration;
+        });
+    }
+    TimePoint deadline;
+    {
+        std::lock_guard<std::mutex> lock(map_mutex_);
+        if (restored_ != nullptr) {
+            if (err != nullptr) {
+                snprintf(err, 1024, "Jobs of the last restore are not all loaded.");
+            }
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        restored_ = jobs;
+        pending_ += count;
+        deadline = restoredDeadline();
+        if (!lock_free_ && deadline < alarm_time_) {
+            setNewAlarm(deadline);
+        }
+    }
+    if (lock_free_) {
+        // Alarm is set by loop thread.
+        wakeIfEarlier(deadline);
+    }
+    return true;
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+void BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::loadRestored(
+        const TimePoint& now) {
+    // Built when due, a bounded batch keeps the critical section short.
+    RestoredJobs& jobs = *restored_;
+    const size_t batch = RestoreBatch;
+    const PersistentCallback* func = nullptr;
+    uint32_t func_id = 0;
+    for (size_t loaded = 0; jobs.next < jobs.count && loaded < batch; ++loaded) {
+        const TimerRecord& record = jobs.records[jobs.next];
+        auto expiration = jobs.expirationOf(record);
+        if (expiration > now) {
+            break;
+        }
+        // Callbacks are checked by restore().
+        if (func == nullptr || func_id != record.callback_id) {
+            func = persistent_callbacks_.find(record.callback_id)->second.get();
+            func_id = record.callback_id;
+        }
+        auto timer = makePersistentTimer(expiration, std::chrono::duration_cast<Accuracy>(
+                std::chrono::nanoseconds(record.period)), func, func_id,
+                record.arg, record.arg_size);
+        if (record.period > 0) {
+            timer->repeat_ = record.repeat != 0;
+        }
+        timer->max_catch_up_ = record.max_catch_up;
+        timer->missed_tick_ = static_cast<MissedTick>(record.missed_tick);
+        timer->priority_ = static_cast<TimerPriority>(record.priority);
+        timer->manager_ = this;
+        timer->slack_ = default_slack_;
+        // Counted in pending_ by restore().
+        timer->pending_ref_ = timer;
+        linkPersistent(timer.get());
+        storage_->insert(timer.get());
+        ++jobs.next;
+    }
+    if (jobs.next == jobs.count) {
+        restored_.reset();
+    }
+}
+
+template <typename ClockPolicy, typename StoragePolicy, typename DispatchPolicy>
+auto BasicManagerTimer<ClockPolicy, StoragePolicy, DispatchPolicy>::restoredDeadline() const
+        -> TimePoint {
+    if (restored_ == nullptr) {
+        return TimePoint::max();
+    }
+    // Same as deadline() of the timer to be built.
+    auto expiration = restored_->expirationOf(restored_->records[restored_->next]);
+    if (expiration > TimePoint::max() - default_slack_) {
+        return TimePoint::max();
+    }
+    return expiration + default_slack_;
+}
+
+#endif //TIMER_SNAPSHOT_H
@@ -0,0 +1,86 @@
+#include "timer_stats.h"
+
+#include <algorithm>
+
+HistogramSnapshot::HistogramSnapshot() :
+        count(0),
+        sum(0),
+        max(0) {
+    buckets.fill(0);
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(p * static_cast<double>(count));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketNum; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t upper = (uint64_t(1) << i) - 1;
+            return std::min(upper, max);
+        }
+    }
+    return max;
+}
+
+HistogramSnapshot& HistogramSnapshot::operator+= (const HistogramSnapshot& other) {
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+    for (size_t i = 0; i < BucketNum; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    return *this;
+}
+
+LatencyHistogram::LatencyHistogram() :
+        sum_(0),
+        max_(0) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    size_t index = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    index = std::min(index, HistogramSnapshot::BucketNum - 1);
+    buckets_[index].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max &&
+           !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) { }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < HistogramSnapshot::BucketNum; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+TimerStats& TimerStats::operator+= (const TimerStats& other) {
+    wakeups += other.wakeups;
+    wakeups_saved += other.wakeups_saved;
+    rearms += other.rearms;
+    fired += other.fired;
+    over_time_drops += other.over_time_drops;
+    extends += other.extends;
+    overload_drops += other.overload_drops;
+    overload_inline += other.overload_inline;
+    overload_blocks += other.overload_blocks;
+    in_flight += other.in_flight;
+    pending += other.pending;
+    fire_lag += other.fire_lag;
+    queue_wait += other.queue_wait;
+    for (size_t i = 0; i < PriorityNum; ++i) {
+        class_queue_wait[i] += other.class_queue_wait[i];
+    }
+    run_time += other.run_time;
+    return *this;
+}
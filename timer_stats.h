@@ -0,0 +1,96 @@
+#ifndef TIMER_STATS_H
+#define TIMER_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Copy of a LatencyHistogram. Values are nanoseconds.
+// Count is the sum of buckets, so it may differ from sum slightly while
+// values are being recorded.
+struct HistogramSnapshot {
+    static const size_t BucketNum = 64;
+
+    HistogramSnapshot();
+    // Upper bound of the bucket which p (0 ~ 1) of values fall in.
+    uint64_t percentile(double p) const;
+    double mean() const {
+        return count == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(count);
+    }
+    HistogramSnapshot& operator+= (const HistogramSnapshot& other);
+
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    // Bucket i counts values in [2^(i-1), 2^i), bucket 0 counts 0.
+    std::array<uint64_t, BucketNum> buckets;
+};
+
+// Log2 bucketed histogram. Lock free, record() is a few relaxed atomic adds.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator= (const LatencyHistogram&) = delete;
+
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+
+private:
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::BucketNum> buckets_;
+};
+
+// Snapshot of ManagerTimer::stats().
+struct TimerStats {
+    static const size_t PriorityNum = 3;
+
+    TimerStats() :
+            wakeups(0),
+            wakeups_saved(0),
+            rearms(0),
+            fired(0),
+            over_time_drops(0),
+            extends(0),
+            overload_drops(0),
+            overload_inline(0),
+            overload_blocks(0),
+            in_flight(0),
+            pending(0) { }
+    TimerStats& operator+= (const TimerStats& other);
+
+    // Loop thread handled expiration.
+    uint64_t wakeups;
+    // Expirations fired before their own deadline by a wakeup of an earlier
+    // one. (Timer slack)
+    uint64_t wakeups_saved;
+    // System timer is set.
+    uint64_t rearms;
+    // Callbacks dispatched.
+    uint64_t fired;
+    // Callbacks skipped by over time.
+    uint64_t over_time_drops;
+    // Extended timers moved to their new expiration.
+    uint64_t extends;
+    // Callbacks over max in flight: skipped, run in loop thread, and
+    // times loop waited. (OverloadPolicy)
+    uint64_t overload_drops;
+    uint64_t overload_inline;
+    uint64_t overload_blocks;
+    // Callbacks queued or running in thread pool (executor).
+    uint64_t in_flight;
+    // Timers in storage.
+    uint64_t pending;
+    // Handling time - expiration.
+    HistogramSnapshot fire_lag;
+    // Time callback waits in thread pool queue.
+    HistogramSnapshot queue_wait;
+    // Queue wait of every priority class, indexed by TimerPriority.
+    std::array<HistogramSnapshot, PriorityNum> class_queue_wait;
+    // Callback execution time.
+    HistogramSnapshot run_time;
+};
+
+#endif //TIMER_STATS_H
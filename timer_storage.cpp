@@ -0,0 +1,436 @@
+#include "timer_storage.h"
+
+#include <algorithm>
+#include <limits>
+
+TimerMapStorage::TimerMapStorage() :
+        timer_map_(std::less<TimePoint>(), TimerMap::allocator_type(
+                std::make_shared<TimerNodePool>())),
+        next_deadline_(TimePoint::min()) { }
+
+void TimerMapStorage::insert(Timer* timer) {
+    if (next_deadline_ != TimePoint::min()) {
+        next_deadline_ = std::min(next_deadline_, timer->deadline());
+    }
+    // Not earlier than the last one (sorted bulk load, same duration),
+    // append in amortized O(1).
+    if (!timer_map_.empty() && !(timer->expiration_ < timer_map_.rbegin()->first)) {
+        timer->map_iter_ = timer_map_.emplace_hint(timer_map_.end(), timer->expiration_, timer);
+        return;
+    }
+    timer->map_iter_ = timer_map_.emplace(timer->expiration_, timer);
+}
+
+void TimerMapStorage::erase(Timer* timer) {
+    forget(timer);
+    timer_map_.erase(timer->map_iter_);
+}
+
+Timer* TimerMapStorage::popExpired(const TimePoint& now) {
+    auto iter = timer_map_.begin();
+    if (iter == timer_map_.end() || iter->first > now) {
+        return nullptr;
+    }
+    Timer* timer = iter->second;
+    forget(timer);
+    timer_map_.erase(iter);
+    return timer;
+}
+
+void TimerMapStorage::popAllExpired(const TimePoint& now, std::vector<Timer*>& timers) {
+    auto end = timer_map_.upper_bound(now);
+    if (end != timer_map_.begin()) {
+        forget(timer_map_.begin()->second);
+    }
+    for (auto iter = timer_map_.begin(); iter != end; ++iter) {
+        timers.push_back(iter->second);
+    }
+    timer_map_.erase(timer_map_.begin(), end);
+}
+
+Timer* TimerMapStorage::popAny() {
+    return popExpired(TimePoint::max());
+}
+
+void TimerMapStorage::forEach(const std::function<void(Timer*)>& func) const {
+    for (auto& pair : timer_map_) {
+        func(pair.second);
+    }
+}
+
+TimerMapStorage::TimePoint TimerMapStorage::nextDeadline() const {
+    if (next_deadline_ != TimePoint::min()) {
+        return next_deadline_;
+    }
+    // Timers expire at or after the deadline can't make it earlier.
+    auto deadline = TimePoint::max();
+    size_t scanned = 0;
+    for (auto iter = timer_map_.begin();
+         iter != timer_map_.end() && iter->first < deadline; ++iter) {
+        if (++scanned > DeadlineScanLimit) {
+            deadline = iter->first;
+            break;
+        }
+        deadline = std::min(deadline, iter->second->deadline());
+    }
+    next_deadline_ = deadline;
+    return deadline;
+}
+
+TimerHeapStorage::TimerHeapStorage() :
+        next_deadline_(TimePoint::min()) { }
+
+void TimerHeapStorage::insert(Timer* timer) {
+    if (next_deadline_ != TimePoint::min()) {
+        next_deadline_ = std::min(next_deadline_, timer->deadline());
+    }
+    heap_.push_back(timer);
+    timer->heap_index_ = heap_.size() - 1;
+    siftUp(heap_.size() - 1);
+}
+
+void TimerHeapStorage::erase(Timer* timer) {
+    removeAt(timer->heap_index_);
+}
+
+Timer* TimerHeapStorage::popExpired(const TimePoint& now) {
+    if (heap_.empty() || heap_.front()->expiration_ > now) {
+        return nullptr;
+    }
+    Timer* timer = heap_.front();
+    removeAt(0);
+    return timer;
+}
+
+Timer* TimerHeapStorage::popAny() {
+    if (heap_.empty()) {
+        return nullptr;
+    }
+    Timer* timer = heap_.back();
+    heap_.pop_back();
+    next_deadline_ = TimePoint::min();
+    return timer;
+}
+
+TimerHeapStorage::TimePoint TimerHeapStorage::nextDeadline() const {
+    if (next_deadline_ != TimePoint::min()) {
+        return next_deadline_;
+    }
+    // Children never expire earlier than parent, skip subtrees which
+    // expire at or after the deadline found.
+    auto deadline = TimePoint::max();
+    size_t scanned = 0;
+    scan_stack_.assign(1, 0);
+    while (!scan_stack_.empty()) {
+        size_t index = scan_stack_.back();
+        scan_stack_.pop_back();
+        if (index >= heap_.size() || !(heap_[index]->expiration_ < deadline)) {
+            continue;
+        }
+        if (++scanned > DeadlineScanLimit) {
+            // Subtree never expire earlier than its root.
+            deadline = heap_[index]->expiration_;
+            continue;
+        }
+        deadline = std::min(deadline, heap_[index]->deadline());
+        scan_stack_.push_back(index * 2 + 1);
+        scan_stack_.push_back(index * 2 + 2);
+    }
+    next_deadline_ = deadline;
+    return deadline;
+}
+
+void TimerHeapStorage::forEach(const std::function<void(Timer*)>& func) const {
+    for (Timer* timer : heap_) {
+        func(timer);
+    }
+}
+
+void TimerHeapStorage::place(Timer* timer, size_t index) {
+    heap_[index] = timer;
+    timer->heap_index_ = index;
+}
+
+void TimerHeapStorage::siftUp(size_t index) {
+    Timer* timer = heap_[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!(timer->expiration_ < heap_[parent]->expiration_)) {
+            break;
+        }
+        place(heap_[parent], index);
+        index = parent;
+    }
+    place(timer, index);
+}
+
+void TimerHeapStorage::siftDown(size_t index) {
+    Timer* timer = heap_[index];
+    size_t size = heap_.size();
+    for (;;) {
+        size_t child = index * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && heap_[child + 1]->expiration_ < heap_[child]->expiration_) {
+            ++child;
+        }
+        if (!(heap_[child]->expiration_ < timer->expiration_)) {
+            break;
+        }
+        place(heap_[child], index);
+        index = child;
+    }
+    place(timer, index);
+}
+
+void TimerHeapStorage::removeAt(size_t index) {
+    if (heap_[index]->expiration_ <= next_deadline_) {
+        next_deadline_ = TimePoint::min();
+    }
+    Timer* last = heap_.back();
+    heap_.pop_back();
+    if (index == heap_.size()) {
+        return;
+    }
+    place(last, index);
+    if (index > 0 && last->expiration_ < heap_[(index - 1) / 2]->expiration_) {
+        siftUp(index);
+    } else {
+        siftDown(index);
+    }
+}
+
+TimingWheelStorage::TimingWheelStorage(const Accuracy& tick,
+        unsigned int levels, const TimePoint& origin) :
+        tick_(tick),
+        levels_(levels),
+        origin_(origin),
+        current_tick_(0),
+        slots_(levels * SlotNum + 1, nullptr),
+        occupied_(levels, 0),
+        due_slot_(levels * SlotNum),
+        size_(0) { }
+
+void TimingWheelStorage::insert(Timer* timer) {
+    timer->wheel_tick_ = tickCeil(timer->expiration_);
+    place(timer);
+    ++size_;
+}
+
+void TimingWheelStorage::erase(Timer* timer) {
+    unlink(timer);
+    --size_;
+}
+
+Timer* TimingWheelStorage::popExpired(const TimePoint& now) {
+    if (slots_[due_slot_] == nullptr) {
+        if (size_ == 0 || now < origin_) {
+            return nullptr;
+        }
+        auto target = tickFloor(now);
+        if (target < current_tick_) {
+            return nullptr;
+        }
+        advance(target);
+    }
+    Timer* timer = slots_[due_slot_];
+    if (timer != nullptr) {
+        erase(timer);
+    }
+    return timer;
+}
+
+void TimingWheelStorage::popAllExpired(const TimePoint& now, std::vector<Timer*>& timers) {
+    if (size_ != 0 && now >= origin_) {
+        auto target = tickFloor(now);
+        if (target >= current_tick_) {
+            advance(target);
+        }
+    }
+    // Splice the whole due list.
+    Timer* timer = slots_[due_slot_];
+    slots_[due_slot_] = nullptr;
+    while (timer != nullptr) {
+        Timer* next = timer->next_;
+        timer->prev_ = nullptr;
+        timer->next_ = nullptr;
+        timers.push_back(timer);
+        --size_;
+        timer = next;
+    }
+}
+
+Timer* TimingWheelStorage::popAny() {
+    Timer* timer = slots_[due_slot_];
+    for (unsigned int level = 0; timer == nullptr && level < levels_; ++level) {
+        if (occupied_[level] != 0) {
+            timer = slots_[level * SlotNum + __builtin_ctzll(occupied_[level])];
+        }
+    }
+    if (timer != nullptr) {
+        erase(timer);
+    }
+    return timer;
+}
+
+void TimingWheelStorage::forEach(const std::function<void(Timer*)>& func) const {
+    for (Timer* head : slots_) {
+        for (Timer* timer = head; timer != nullptr; timer = timer->next_) {
+            func(timer);
+        }
+    }
+}
+
+TimingWheelStorage::TimePoint TimingWheelStorage::nextExpiration() const {
+    if (slots_[due_slot_] != nullptr) {
+        return origin_;
+    }
+    auto next_tick = std::numeric_limits<uint64_t>::max();
+    for (unsigned int level = 0; level < levels_; ++level) {
+        auto bits = occupied_[level];
+        if (bits == 0) {
+            continue;
+        }
+        unsigned int shift = SlotBits * level;
+        uint64_t cur = current_tick_ >> shift;
+        uint64_t index = cur & SlotMask;
+        uint64_t base = cur - index;
+        // Slot of current index belongs to next round, unless it will
+        // be cascaded at current tick.
+        bool aligned = (current_tick_ & ((uint64_t(1) << shift) - 1)) == 0;
+        uint64_t from = aligned ? index : index + 1;
+        uint64_t later = from < SlotNum ? bits & (~uint64_t(0) << from) : 0;
+        uint64_t slot = later != 0 ?
+                base + __builtin_ctzll(later) :
+                base + SlotNum + __builtin_ctzll(bits);
+        next_tick = std::min(next_tick, slot << shift);
+    }
+    auto max_tick = static_cast<uint64_t>(
+            (TimePoint::max() - origin_) / tick_);
+    if (next_tick >= max_tick) {
+        return TimePoint::max();
+    }
+    return origin_ + tick_ * next_tick;
+}
+
+uint64_t TimingWheelStorage::tickCeil(const TimePoint& time_point) const {
+    if (time_point <= origin_) {
+        return 0;
+    }
+    auto elapse = static_cast<uint64_t>((time_point - origin_).count());
+    auto tick = static_cast<uint64_t>(tick_.count());
+    return elapse / tick + (elapse % tick != 0 ? 1 : 0);
+}
+
+uint64_t TimingWheelStorage::tickFloor(const TimePoint& time_point) const {
+    if (time_point <= origin_) {
+        return 0;
+    }
+    return static_cast<uint64_t>((time_point - origin_) / tick_);
+}
+
+void TimingWheelStorage::place(Timer* timer) {
+    auto expire = timer->wheel_tick_;
+    if (expire < current_tick_) {
+        // Tick is already processed, it is due now.
+        link(timer, due_slot_);
+        return;
+    }
+    auto delta = expire - current_tick_;
+    unsigned int level = 0;
+    while (level + 1 < levels_ && (delta >> (SlotBits * (level + 1))) != 0) {
+        ++level;
+    }
+    if ((delta >> (SlotBits * (level + 1))) != 0) {
+        // Out of range, park it in the farthest slot.
+        expire = current_tick_ + (uint64_t(1) << (SlotBits * levels_)) - 1;
+    }
+    auto index = (expire >> (SlotBits * level)) & SlotMask;
+    link(timer, static_cast<unsigned int>(level * SlotNum + index));
+}
+
+void TimingWheelStorage::link(Timer* timer, unsigned int slot) {
+    Timer*& head = slots_[slot];
+    timer->wheel_slot_ = slot;
+    timer->prev_ = nullptr;
+    timer->next_ = head;
+    if (head != nullptr) {
+        head->prev_ = timer;
+    }
+    head = timer;
+    if (slot != due_slot_) {
+        occupied_[slot / SlotNum] |= uint64_t(1) << (slot & SlotMask);
+    }
+}
+
+void TimingWheelStorage::unlink(Timer* timer) {
+    auto slot = timer->wheel_slot_;
+    if (timer->prev_ != nullptr) {
+        timer->prev_->next_ = timer->next_;
+    } else {
+        slots_[slot] = timer->next_;
+    }
+    if (timer->next_ != nullptr) {
+        timer->next_->prev_ = timer->prev_;
+    }
+    timer->prev_ = nullptr;
+    timer->next_ = nullptr;
+    if (slot != due_slot_ && slots_[slot] == nullptr) {
+        occupied_[slot / SlotNum] &= ~(uint64_t(1) << (slot & SlotMask));
+    }
+}
+
+void TimingWheelStorage::cascade(unsigned int level) {
+    auto index = (current_tick_ >> (SlotBits * level)) & SlotMask;
+    auto slot = static_cast<unsigned int>(level * SlotNum + index);
+    Timer* timer = slots_[slot];
+    slots_[slot] = nullptr;
+    occupied_[level] &= ~(uint64_t(1) << index);
+    while (timer != nullptr) {
+        Timer* next = timer->next_;
+        place(timer);
+        timer = next;
+    }
+}
+
+void TimingWheelStorage::advance(uint64_t target) {
+    while (current_tick_ <= target) {
+        auto index = current_tick_ & SlotMask;
+        if (index == 0) {
+            for (unsigned int level = levels_ - 1; level > 0; --level) {
+                auto mask = (uint64_t(1) << (SlotBits * level)) - 1;
+                if ((current_tick_ & mask) == 0) {
+                    cascade(level);
+                }
+            }
+        }
+        // Move timers of current tick to due list.
+        // Single level wheel may park timers of later round here.
+        Timer* timer = slots_[index];
+        slots_[index] = nullptr;
+        occupied_[0] &= ~(uint64_t(1) << index);
+        while (timer != nullptr) {
+            Timer* next = timer->next_;
+            if (timer->wheel_tick_ <= current_tick_) {
+                link(timer, due_slot_);
+            } else {
+                place(timer);
+            }
+            timer = next;
+        }
+        // Skip empty ticks.
+        uint64_t next_tick;
+        uint64_t later = index < SlotMask ?
+                occupied_[0] & (~uint64_t(0) << (index + 1)) : 0;
+        if (later != 0) {
+            next_tick = current_tick_ - index + __builtin_ctzll(later);
+        } else if (std::all_of(occupied_.begin(), occupied_.end(),
+                [](uint64_t bits) { return bits == 0; })) {
+            next_tick = target + 1;
+        } else {
+            next_tick = (current_tick_ | SlotMask) + 1;
+        }
+        current_tick_ = std::min(next_tick, target + 1);
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef TIMER_STORAGE_H
+#define TIMER_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "timer.h"
+
+// Storage engine of pending timers. ManagerTimer keep the ownership,
+// storage only link raw pointers. Not thread safe, caller must lock.
+class TimerStorage {
+public:
+    using Accuracy = Timer::Accuracy;
+    using TimePoint = Timer::TimePoint;
+
+    virtual ~TimerStorage() = default;
+    // Insert timer by its expiration_.
+    virtual void insert(Timer* timer) = 0;
+    // Remove a pending timer.
+    virtual void erase(Timer* timer) = 0;
+    // Pop one timer which is expired at 'now'. Return nullptr if none.
+    virtual Timer* popExpired(const TimePoint& now) = 0;
+    // Pop all timers expired at 'now', append them to timers.
+    virtual void popAllExpired(const TimePoint& now, std::vector<Timer*>& timers) {
+        Timer* timer;
+        while ((timer = popExpired(now)) != nullptr) {
+            timers.push_back(timer);
+        }
+    }
+    // Pop any timer. Return nullptr if empty. (For clean up)
+    virtual Timer* popAny() = 0;
+    // The time point system timer should alarm at. Storage must not empty.
+    virtual TimePoint nextExpiration() const = 0;
+    // The time point system timer should alarm at when timers have slack.
+    // Not later than deadline of any timer. Storage must not empty.
+    virtual TimePoint nextDeadline() const {
+        return nextExpiration();
+    }
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+    // Visit every pending timer, in no particular order.
+    virtual void forEach(const std::function<void(Timer*)>& func) const = 0;
+
+protected:
+    // Timers visited by one nextDeadline() scan, the rest are bounded by
+    // expiration of the first one left.
+    static const size_t DeadlineScanLimit = 64;
+};
+
+// Red-black tree storage. O(log n) insert, amortized O(1) erase.
+// Map nodes are allocated from node pool.
+class TimerMapStorage final : public TimerStorage {
+    using TimerMap = Timer::TimerMap;
+public:
+    TimerMapStorage();
+    void insert(Timer* timer) override;
+    void erase(Timer* timer) override;
+    Timer* popExpired(const TimePoint& now) override;
+    void popAllExpired(const TimePoint& now, std::vector<Timer*>& timers) override;
+    Timer* popAny() override;
+    TimePoint nextExpiration() const override {
+        return timer_map_.begin()->first;
+    }
+    TimePoint nextDeadline() const override;
+    bool empty() const override {
+        return timer_map_.empty();
+    }
+    size_t size() const override {
+        return timer_map_.size();
+    }
+    void forEach(const std::function<void(Timer*)>& func) const override;
+
+private:
+    // Keep cached deadline valid after removing timer.
+    void forget(const Timer* timer) {
+        if (timer->expiration_ <= next_deadline_) {
+            next_deadline_ = TimePoint::min();
+        }
+    }
+
+    TimerMap timer_map_;
+    // Result of the last nextDeadline() scan, lowered by insert and reset
+    // by removing a timer which may be part of it. min() is not scanned.
+    mutable TimePoint next_deadline_;
+};
+
+// Binary min-heap storage. O(log n) insert & erase, O(1) next expiration.
+// One pointer per timer in a vector, no node allocation.
+class TimerHeapStorage final : public TimerStorage {
+public:
+    TimerHeapStorage();
+    void insert(Timer* timer) override;
+    void erase(Timer* timer) override;
+    Timer* popExpired(const TimePoint& now) override;
+    Timer* popAny() override;
+    TimePoint nextExpiration() const override {
+        return heap_.front()->expiration_;
+    }
+    TimePoint nextDeadline() const override;
+    bool empty() const override {
+        return heap_.empty();
+    }
+    size_t size() const override {
+        return heap_.size();
+    }
+    void forEach(const std::function<void(Timer*)>& func) const override;
+
+private:
+    void place(Timer* timer, size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void removeAt(size_t index);
+
+    std::vector<Timer*> heap_;
+    // Same as TimerMapStorage.
+    mutable TimePoint next_deadline_;
+    // DFS stack of nextDeadline(), capacity is kept.
+    mutable std::vector<size_t> scan_stack_;
+};
+
+// Hierarchical timing wheel storage. O(1) insert & erase.
+// Every level has 64 slots, a slot of level N covers 64^N ticks.
+// Timers expire at the end of their tick, never before expiration_.
+// Timers out of range are parked in the farthest slot and re-placed
+// when the slot cascades.
+class TimingWheelStorage final : public TimerStorage {
+public:
+    TimingWheelStorage(const Accuracy& tick, unsigned int levels,
+            const TimePoint& origin);
+    TimingWheelStorage(const TimingWheelStorage&) = delete;
+    TimingWheelStorage& operator= (const TimingWheelStorage&) = delete;
+
+    void insert(Timer* timer) override;
+    void erase(Timer* timer) override;
+    Timer* popExpired(const TimePoint& now) override;
+    void popAllExpired(const TimePoint& now, std::vector<Timer*>& timers) override;
+    Timer* popAny() override;
+    TimePoint nextExpiration() const override;
+    bool empty() const override {
+        return size_ == 0;
+    }
+    size_t size() const override {
+        return size_;
+    }
+    void forEach(const std::function<void(Timer*)>& func) const override;
+
+    static const unsigned int MaxLevels = 10;
+
+private:
+    static const unsigned int SlotBits = 6;
+    static const unsigned int SlotNum = 1u << SlotBits;
+    static const uint64_t SlotMask = SlotNum - 1;
+
+    uint64_t tickCeil(const TimePoint& time_point) const;
+    uint64_t tickFloor(const TimePoint& time_point) const;
+    void place(Timer* timer);
+    void link(Timer* timer, unsigned int slot);
+    void unlink(Timer* timer);
+    void cascade(unsigned int level);
+    void advance(uint64_t target);
+
+    const Accuracy tick_;
+    const unsigned int levels_;
+    const TimePoint origin_;
+    // Next tick to be processed.
+    uint64_t current_tick_;
+    // levels_ * SlotNum slot heads, the last one is due list.
+    std::vector<Timer*> slots_;
+    // Occupied bitmap of every level.
+    std::vector<uint64_t> occupied_;
+    const unsigned int due_slot_;
+    size_t size_;
+};
+
+#endif //TIMER_STORAGE_H
@@ -0,0 +1,150 @@
+#include "timer_thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ThreadPool.h"
+
+#ifdef __linux__
+// CPUs of a NUMA node, sysfs cpulist is like "0-3,8-11".
+static bool numaCpus(int node, std::vector<int>& cpus) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char list[1024] = {0};
+    bool ok = fgets(list, sizeof(list), file) != nullptr;
+    fclose(file);
+    char* pos = list;
+    while (ok && *pos != '\0' && *pos != '\n') {
+        char* end = nullptr;
+        long first = strtol(pos, &end, 10);
+        long last = first;
+        if (end == pos) {
+            return false;
+        }
+        if (*end == '-') {
+            pos = end + 1;
+            last = strtol(pos, &end, 10);
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        pos = *end == ',' ? end + 1 : end;
+    }
+    return ok && !cpus.empty();
+}
+#endif
+
+bool applyThreadOptions(std::thread::native_handle_type handle,
+        const ThreadOptions& options, int index, char* err) {
+    int ret = 0;
+#ifdef __linux__
+    std::vector<int> cpus = options.cpus;
+    if (cpus.empty() && options.numa_node >= 0 &&
+        !numaCpus(options.numa_node, cpus)) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Read CPUs of NUMA node %d failed.", options.numa_node);
+        }
+        return false;
+    }
+    if (!cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+        ret = pthread_setaffinity_np(handle, sizeof(cpu_set), &cpu_set);
+        if (ret != 0) {
+            if (err != nullptr) {
+                snprintf(err, 1024, "Set CPU affinity failed. Errno: %d", ret);
+            }
+            return false;
+        }
+    }
+    if (!options.name.empty()) {
+        std::string name = options.name;
+        if (index >= 0) {
+            name += "-" + std::to_string(index);
+        }
+        // Linux limit is 16 bytes with '\0'.
+        name.resize(std::min<size_t>(name.size(), 15));
+        ret = pthread_setname_np(handle, name.c_str());
+        if (ret != 0) {
+            if (err != nullptr) {
+                snprintf(err, 1024, "Set thread name failed. Errno: %d", ret);
+            }
+            return false;
+        }
+    }
+#else
+    (void)index;
+    if (!options.cpus.empty() || options.numa_node >= 0 || !options.name.empty()) {
+        if (err != nullptr) {
+            snprintf(err, 1024, "Thread affinity & name are not supported.");
+        }
+        return false;
+    }
+#endif
+    if (options.sched_policy >= 0) {
+        struct sched_param param{};
+        param.sched_priority = options.sched_priority;
+        ret = pthread_setschedparam(handle, options.sched_policy, &param);
+        if (ret != 0) {
+            if (err != nullptr) {
+                snprintf(err, 1024, "Set scheduling policy failed. Errno: %d", ret);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool placeThreadPool(ThreadPool& pool, size_t threads,
+        const ThreadOptions& options, char* err) {
+    // Every job waits until all are running, so each worker takes one.
+    struct Barrier {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t arrived = 0;
+    };
+    auto barrier = std::make_shared<Barrier>();
+    std::vector<std::future<bool>> results;
+    for (size_t i = 0; i < threads; ++i) {
+        results.emplace_back(pool.enqueue([barrier, threads, &options]() {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(barrier->mutex);
+                index = static_cast<int>(barrier->arrived++);
+                barrier->cv.notify_all();
+                if (!barrier->cv.wait_for(lock, std::chrono::seconds(1), [&barrier, threads]() {
+                    return barrier->arrived >= threads;
+                })) {
+                    return false;
+                }
+            }
+            return applyThreadOptions(pthread_self(), options, index);
+        }));
+    }
+    bool ok = true;
+    for (auto& result : results) {
+        ok = result.get() && ok;
+    }
+    if (!ok && err != nullptr) {
+        snprintf(err, 1024, "Place thread pool failed, pool is busy or option is invalid.");
+    }
+    return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef TIMER_THREAD_H
+#define TIMER_THREAD_H
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ThreadPool;
+
+// Placement of loop & pool threads. Default changes nothing.
+// Affinity & name are Linux only.
+struct ThreadOptions {
+    ThreadOptions() :
+            numa_node(-1),
+            sched_policy(-1),
+            sched_priority(0) { }
+
+    // CPUs thread may run on, empty is all.
+    std::vector<int> cpus;
+    // Run on CPUs of this NUMA node, used if cpus is empty.
+    int numa_node;
+    // SCHED_OTHER, SCHED_FIFO, SCHED_RR... -1 keeps current policy.
+    // SCHED_FIFO & SCHED_RR need privilege (CAP_SYS_NICE).
+    int sched_policy;
+    int sched_priority;
+    // Cut to 15 characters. Pool threads get "-index" suffix.
+    std::string name;
+};
+
+// Apply options to a thread. Index is suffix of pool thread name, -1 is none.
+bool applyThreadOptions(std::thread::native_handle_type handle,
+        const ThreadOptions& options, int index, char* err = nullptr);
+// Apply options to every worker of a ThreadPool. Pool must be idle and
+// have exactly 'threads' workers, every worker takes one placement job.
+bool placeThreadPool(ThreadPool& pool, size_t threads,
+        const ThreadOptions& options, char* err = nullptr);
+
+#endif //TIMER_THREAD_H
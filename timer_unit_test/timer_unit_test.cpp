@@ -3,10 +3,17 @@
 //
 
 #include "manager_timer.h"
+#include "priority_executor.h"
+#include "sharded_manager_timer.h"
+#include "timer_snapshot.h"
+#include "timer_awaitable.h"
+#include "work_stealing_executor.h"
 #include <gtest/gtest.h>
 #include "ThreadPool.h"
+#include <algorithm>
 #include <iostream>
 #include <locale>
+#include <set>
 
 ThreadPool* tp;
 ManagerTimer* timer_m;
@@ -109,6 +116,1019 @@ TEST (BaseFuncTest, addTimerRepeat) {
     }
 }
 
+TEST (BaseFuncTest, timingWheel) {
+    ManagerTimer mt;
+    // Level 0 spans 6.4ms, level 1 409.6ms.
+    ASSERT_TRUE(mt.setTimingWheel(std::chrono::microseconds(100), 2));
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto begin = ManagerTimer::Clock::now();
+    // Cover level 0, level 1 and out of range.
+    std::vector<std::future<int>> futures;
+    const int delays[] = {0, 3, 20, 100, 300, 600};
+    for (int delay : delays) {
+        futures.emplace_back(mt.addJobRunAfter(std::chrono::milliseconds(delay),
+                [delay]() { return delay; }).second);
+    }
+    for (size_t i = 0; i < futures.size(); ++i) {
+        ASSERT_TRUE(futures[i].get() == delays[i]);
+        auto elapse = ManagerTimer::Clock::now() - begin;
+        ASSERT_TRUE(elapse >= std::chrono::milliseconds(delays[i]));
+    }
+    ASSERT_FALSE(mt.setTimingWheel(std::chrono::seconds(0)));
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, cancelTimer) {
+    auto arg = std::make_shared<int>(0);
+    auto pair = timer_m->addJobRunAfter(std::chrono::seconds(2),
+            [](std::shared_ptr<int> p) { return *p; }, arg);
+    ASSERT_TRUE(arg.use_count() == 2);
+    ASSERT_TRUE(timer_m->cancel(pair.first));
+    // Bound arguments are released at once.
+    ASSERT_TRUE(arg.use_count() == 1);
+    ASSERT_TRUE(pair.first->isCancelled());
+    try {
+        pair.second.get();
+        ASSERT_TRUE(false);
+    } catch (const std::future_error& e) {
+        ASSERT_TRUE(e.code() == std::future_errc::broken_promise);
+    }
+    ASSERT_FALSE(timer_m->cancel(pair.first));
+
+    std::atomic_int count(0);
+    auto timer = timer_m->addJobRunEvery(std::chrono::milliseconds(100),
+            [&count]() { ++count; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    ASSERT_TRUE(timer_m->cancel(timer));
+    int fired = count;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_TRUE(count == fired);
+
+    // Running timer is not cancelled, its job still finishes.
+    std::atomic_bool started(false);
+    auto running = timer_m->addJobRunAfter(std::chrono::milliseconds(1), [&started]() {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return 1;
+    });
+    while (!started) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_FALSE(timer_m->cancel(running.first));
+    ASSERT_FALSE(running.first->isCancelled());
+    ASSERT_TRUE(running.second.get() == 1);
+}
+
+TEST (BaseFuncTest, extendTimer) {
+    for (bool wheel : {false, true}) {
+        ManagerTimer mt;
+        if (wheel) {
+            ASSERT_TRUE(mt.setTimingWheel(std::chrono::milliseconds(1)));
+        }
+        ASSERT_TRUE(mt.init());
+        ASSERT_TRUE(mt.start());
+        std::atomic<ManagerTimer::Clock::rep> fired_at(0);
+        auto begin = ManagerTimer::Clock::now();
+        auto timer = mt.postJobRunAfter(std::chrono::milliseconds(20), [&fired_at]() {
+            fired_at = ManagerTimer::Clock::now().time_since_epoch().count();
+        });
+        // Idle timeout pushed later by traffic, timer is moved lazily.
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(mt.extendAfter(timer, std::chrono::milliseconds(20)));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        auto last_touch = ManagerTimer::Clock::now();
+        while (fired_at == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        auto fired = ManagerTimer::Clock::time_point(ManagerTimer::Clock::duration(fired_at));
+        ASSERT_TRUE(fired - begin >= std::chrono::milliseconds(60));
+        ASSERT_TRUE(fired - last_touch >= std::chrono::milliseconds(10));
+        ASSERT_TRUE(mt.stats().extends >= 1);
+        ASSERT_TRUE(mt.stats().fired == 1);
+        // Fired timer can't be extended, caller must add it again.
+        ASSERT_FALSE(mt.extendAfter(timer, std::chrono::milliseconds(20)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        ASSERT_TRUE(mt.stats().fired == 1);
+        mt.stopAndJoin();
+    }
+}
+
+TEST (BaseFuncTest, shardedTimer) {
+    ShardedManagerTimer mt(4);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    ASSERT_TRUE(&mt.shardOf(std::string("conn")) == &mt.shardOf(std::string("conn")));
+    std::vector<std::future<size_t>> futures(8);
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < futures.size(); ++i) {
+        producers.emplace_back([&mt, &futures, i]() {
+            futures[i] = mt.addJobRunAfter(std::chrono::milliseconds(10),
+                    [i]() { return i; }).second;
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    for (size_t i = 0; i < futures.size(); ++i) {
+        ASSERT_TRUE(futures[i].get() == i);
+    }
+    auto timer = mt.shardOf(42).addJobRunEvery(std::chrono::seconds(1), for_test1);
+    ASSERT_TRUE(mt.cancel(timer));
+    ASSERT_FALSE(mt.shard(0).cancel(nullptr));
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, timerFd) {
+    ManagerTimer mt;
+    ASSERT_TRUE(mt.setAlarmType(ManagerTimer::AlarmType::TimerFd));
+    ASSERT_TRUE(mt.init());
+    ASSERT_FALSE(mt.setAlarmType(ManagerTimer::AlarmType::PosixTimer));
+    ASSERT_TRUE(mt.start());
+    auto pair = mt.addJobRunAfter(std::chrono::milliseconds(20), []() { return 7; });
+    ASSERT_TRUE(pair.second.get() == 7);
+    mt.stopAndJoin();
+
+    // Embedded in user's reactor without loop thread.
+    ManagerTimer embedded;
+    embedded.setAlarmType(ManagerTimer::AlarmType::TimerFd);
+    ASSERT_TRUE(embedded.init());
+    ASSERT_TRUE(embedded.getFd() >= 0);
+    auto pair1 = embedded.addJobRunAfter(std::chrono::milliseconds(20), []() { return 8; });
+    ASSERT_TRUE(embedded.pollOnce(0) == 0);
+    int count = 0;
+    while (count == 0) {
+        count = embedded.pollOnce(-1);
+    }
+    ASSERT_TRUE(count == 1);
+    ASSERT_TRUE(pair1.second.get() == 8);
+}
+
+TEST (BaseFuncTest, scheduleBatch) {
+    ManagerTimer::ScheduleBatch batch;
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.emplace_back(batch.addJobRunAfter(
+                std::chrono::milliseconds(i % 50), [i]() { return i; }).second);
+    }
+    std::atomic_int count(0);
+    batch.addJobRunEvery(std::chrono::milliseconds(10), [&count]() { ++count; });
+    ASSERT_TRUE(batch.size() == 1001);
+    auto handles = timer_m->schedule(batch);
+    ASSERT_TRUE(handles.size() == 1001);
+    ASSERT_TRUE(batch.size() == 0);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(futures[i].get() == i);
+    }
+    while (count < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(timer_m->cancel(handles.back()));
+}
+
+TEST (BaseFuncTest, lockFreeSubmit) {
+    for (auto type : {ManagerTimer::AlarmType::PosixTimer,
+                      ManagerTimer::AlarmType::TimerFd}) {
+        ManagerTimer mt(tp);
+        ASSERT_TRUE(mt.setAlarmType(type));
+        ASSERT_TRUE(mt.setLockFreeSubmit(true));
+        ASSERT_TRUE(mt.init());
+        ASSERT_FALSE(mt.setLockFreeSubmit(false));
+        ASSERT_TRUE(mt.start());
+        // Later job first, earlier job must wake the loop up.
+        auto late = mt.addJobRunAfter(std::chrono::seconds(1), []() { return 1; });
+        std::vector<std::future<int>> futures(400);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&mt, &futures, t]() {
+                for (int i = t; i < 400; i += 4) {
+                    futures[i] = mt.addJobRunAfter(
+                            std::chrono::milliseconds(i % 20), [i]() { return i; }).second;
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        for (int i = 0; i < 400; ++i) {
+            ASSERT_TRUE(futures[i].get() == i);
+        }
+        ASSERT_TRUE(late.second.wait_for(std::chrono::milliseconds(0)) ==
+                std::future_status::timeout);
+        ASSERT_TRUE(mt.cancel(late.first));
+        ASSERT_FALSE(mt.cancel(late.first));
+
+        std::atomic_int count(0);
+        auto timer = mt.addJobRunEvery(std::chrono::milliseconds(10),
+                [&count]() { ++count; });
+        while (count < 3) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_TRUE(mt.cancel(timer));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        int fired = count;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_TRUE(count == fired);
+
+        // Cancelled while callback is running, it isn't sent back.
+        std::atomic_bool running(false);
+        auto busy = mt.addJobRunEvery(std::chrono::milliseconds(5), [&running, &count]() {
+            running = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            ++count;
+        });
+        while (!running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(mt.cancel(busy));
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        fired = count;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ASSERT_TRUE(count == fired);
+        ASSERT_TRUE(mt.stats().pending == 0);
+        mt.stopAndJoin();
+    }
+}
+
+// Strict job behind more lazy jobs than one deadline scan visits.
+template <typename MT>
+static void checkDeadlineScan() {
+    MT mt;
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto begin = ManagerTimer::Clock::now();
+    std::vector<std::future<int>> lazies;
+    for (int i = 0; i < 200; ++i) {
+        lazies.emplace_back(mt.addJobRunAfter(TimerOptions().setSlack(std::chrono::seconds(10)),
+                std::chrono::milliseconds(20) + std::chrono::microseconds(i),
+                [i]() { return i; }).second);
+    }
+    auto strict = mt.addJobRunAfter(TimerOptions().setSlack(std::chrono::seconds(0)),
+            std::chrono::milliseconds(40), []() { return -1; });
+    ASSERT_TRUE(strict.second.get() == -1);
+    ASSERT_TRUE(ManagerTimer::Clock::now() - begin < std::chrono::seconds(1));
+    for (auto& lazy : lazies) {
+        ASSERT_TRUE(lazy.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, timerSlack) {
+    ManagerTimer mt;
+    mt.setDefaultSlack(std::chrono::milliseconds(50));
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.emplace_back(mt.addJobRunAfter(
+                std::chrono::milliseconds(i * 2), [i]() { return i; }).second);
+    }
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(futures[i].get() == i);
+    }
+    auto saved = mt.getWakeupsSaved();
+    ASSERT_TRUE(saved > 0);
+    // Lazy job is fired together with the strict one.
+    auto lazy = mt.addJobRunAfter(TimerOptions().setSlack(std::chrono::seconds(10)),
+            std::chrono::milliseconds(5), []() { return 1; });
+    auto strict = mt.addJobRunAfter(TimerOptions().setSlack(std::chrono::seconds(0)),
+            std::chrono::milliseconds(10), []() { return 2; });
+    ASSERT_TRUE(strict.second.get() == 2);
+    ASSERT_TRUE(lazy.second.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+    ASSERT_TRUE(mt.getWakeupsSaved() > saved);
+    mt.stopAndJoin();
+
+    // Jobs already past their deadline at wakeup saved nothing.
+    ManagerTimer late;
+    ASSERT_TRUE(late.init());
+    auto past = ManagerTimer::Clock::now() - std::chrono::milliseconds(100);
+    std::vector<std::future<int>> past_futures;
+    for (int i = 0; i < 10; ++i) {
+        past_futures.emplace_back(late.addJobRunAt(
+                past + std::chrono::milliseconds(i), [i]() { return i; }).second);
+    }
+    ASSERT_TRUE(late.start());
+    for (auto& future : past_futures) {
+        future.get();
+    }
+    ASSERT_TRUE(late.getWakeupsSaved() == 0);
+    late.stopAndJoin();
+
+    checkDeadlineScan<ManagerTimer>();
+    checkDeadlineScan<BasicManagerTimer<SteadyClockPolicy, TimerHeapStorage>>();
+}
+
+TEST (BaseFuncTest, timerStats) {
+    ManagerTimer mt(tp);
+    mt.setOverTime(std::chrono::milliseconds(100));
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.emplace_back(mt.addJobRunAfter(
+                std::chrono::milliseconds(i % 10), [i]() { return i; }).second);
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(futures[i].get() == i);
+    }
+    // Expired long ago, skipped by over time.
+    auto late = mt.addJobRunAt(std::chrono::steady_clock::now() - std::chrono::seconds(1),
+            []() { return 0; });
+    while (mt.stats().over_time_drops == 0 || mt.stats().run_time.count < 100) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto stats = mt.stats();
+    ASSERT_TRUE(stats.fired == 100);
+    ASSERT_TRUE(stats.over_time_drops == 1);
+    ASSERT_TRUE(stats.fire_lag.count == 100);
+    ASSERT_TRUE(stats.queue_wait.count == 100);
+    ASSERT_TRUE(stats.run_time.count == 100);
+    ASSERT_TRUE(stats.fire_lag.percentile(0.5) <= stats.fire_lag.percentile(0.99));
+    ASSERT_TRUE(stats.fire_lag.percentile(1) <= stats.fire_lag.max);
+    ASSERT_TRUE(stats.wakeups > 0);
+    ASSERT_TRUE(stats.rearms > 0);
+    ASSERT_TRUE(stats.pending == 0);
+    auto timer = mt.postJobRunAfter(std::chrono::hours(1), []() { });
+    ASSERT_TRUE(mt.stats().pending == 1);
+    ASSERT_TRUE(mt.cancel(timer));
+    ASSERT_TRUE(mt.stats().pending == 0);
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, workStealingExecutor) {
+    WorkStealingExecutor executor(4);
+    ASSERT_TRUE(executor.enqueue([](int a) { return a + 1; }, 1).get() == 2);
+    ManagerTimer mt;
+    mt.setExecutor(&executor);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto arg = std::make_shared<int>(0);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.emplace_back(mt.addJobRunAfter(std::chrono::milliseconds(i % 10),
+                [i](std::shared_ptr<int>) { return i; }, arg).second);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(futures[i].get() == i);
+    }
+    std::atomic_int count(0);
+    auto timer = mt.addJobRunEvery(std::chrono::milliseconds(5), [&count]() { ++count; });
+    while (count < 3) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    timer->stopRepeat();
+    // Callbacks & bound arguments are released after run.
+    while (arg.use_count() != 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mt.stopAndJoin();
+    ASSERT_TRUE(mt.stats().queue_wait.count >= 1003);
+}
+
+TEST (BaseFuncTest, executeBatch) {
+    // Executor without executeBatch() gets tasks one by one.
+    struct InlineExecutor : public TimerExecutor {
+        void execute(Callback task) override {
+            ++executed;
+            task();
+        }
+        std::atomic_int executed{0};
+    } inline_executor;
+    std::atomic_int count(0);
+    std::vector<Callback> tasks;
+    for (int i = 0; i < 10; ++i) {
+        tasks.emplace_back([&count]() { ++count; });
+    }
+    inline_executor.executeBatch(tasks);
+    ASSERT_TRUE(tasks.empty());
+    ASSERT_TRUE(count == 10 && inline_executor.executed == 10);
+
+    WorkStealingExecutor executor(4);
+    for (int i = 0; i < 1001; ++i) {
+        tasks.emplace_back([&count]() { ++count; });
+    }
+    executor.executeBatch(tasks);
+    ASSERT_TRUE(tasks.empty());
+    // Burst of same expiration is dispatched by one batch.
+    ManagerTimer mt;
+    mt.setExecutor(&executor);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto expiration = std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+            ManagerTimer::Clock::now() + std::chrono::milliseconds(20));
+    ManagerTimer::ScheduleBatch batch(mt);
+    for (int i = 0; i < 1000; ++i) {
+        batch.addJobRunAt(expiration, [&count]() { ++count; });
+    }
+    mt.schedule(batch);
+    while (count != 2011) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, precisionMode) {
+    for (auto type : {ManagerTimer::AlarmType::PosixTimer, ManagerTimer::AlarmType::TimerFd}) {
+        ManagerTimer mt;
+        ASSERT_TRUE(mt.setAlarmType(type));
+        ASSERT_TRUE(mt.setPrecisionMode(std::chrono::microseconds(200), 0));
+        ASSERT_TRUE(mt.init());
+        ASSERT_FALSE(mt.setPrecisionMode(std::chrono::microseconds(200)));
+        ASSERT_TRUE(mt.start());
+        std::atomic_int count(0);
+        std::atomic<int64_t> early(0);
+        for (int i = 0; i < 20; ++i) {
+            auto expiration = std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+                    ManagerTimer::Clock::now() + std::chrono::milliseconds(2 * i));
+            mt.postJobRunAt(expiration, [&count, &early, expiration]() {
+                // Spinning never fires a timer early.
+                if (ManagerTimer::Clock::now() < expiration) {
+                    ++early;
+                }
+                ++count;
+            });
+        }
+        while (count != 20) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        mt.stopAndJoin();
+        ASSERT_TRUE(early == 0);
+    }
+}
+
+TEST (BaseFuncTest, threadOptions) {
+    auto threadName = []() {
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        return std::string(name);
+    };
+    ThreadOptions options;
+    options.cpus.push_back(0);
+    options.sched_policy = SCHED_OTHER;
+    options.name = "timer-loop";
+    ManagerTimer mt;
+    mt.setThreadOptions(options);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto loop_name = mt.addJobRunAfter(std::chrono::milliseconds(1), threadName).second.get();
+    ASSERT_TRUE(loop_name == "timer-loop");
+    auto cpu_count = mt.addJobRunAfter(std::chrono::milliseconds(1), []() {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        sched_getaffinity(0, sizeof(cpu_set), &cpu_set);
+        return CPU_COUNT(&cpu_set) == 1 && CPU_ISSET(0, &cpu_set);
+    }).second.get();
+    ASSERT_TRUE(cpu_count);
+    mt.stopAndJoin();
+    // Invalid option fails start().
+    ManagerTimer bad_mt;
+    options.sched_policy = 12345;
+    bad_mt.setThreadOptions(options);
+    ASSERT_TRUE(bad_mt.init());
+    char err[1024] = {0};
+    ASSERT_FALSE(bad_mt.start(err));
+
+    ThreadOptions pool_options;
+    pool_options.numa_node = 0;
+    pool_options.name = "pool";
+    ThreadPool pool(2);
+    ASSERT_TRUE(placeThreadPool(pool, 2, pool_options));
+    ASSERT_TRUE(pool.enqueue(threadName).get().find("pool-") == 0);
+    WorkStealingExecutor executor(2);
+    pool_options.name = "steal";
+    ASSERT_TRUE(executor.setThreadOptions(pool_options));
+    ASSERT_TRUE(executor.enqueue(threadName).get().find("steal-") == 0);
+}
+
+TEST (BaseFuncTest, priorityExecutor) {
+    PriorityExecutor executor(1);
+    std::mutex mutex;
+    std::vector<int> order;
+    std::promise<void> blocked;
+    std::promise<void> release;
+    auto release_future = release.get_future().share();
+    executor.execute([&blocked, release_future]() {
+        blocked.set_value();
+        release_future.wait();
+    });
+    blocked.get_future().wait();
+    auto now = std::chrono::steady_clock::now();
+    std::vector<Callback> tasks;
+    std::vector<TaskOrder> orders;
+    auto add = [&](int id, TimerPriority priority, int deadline_ms) {
+        tasks.emplace_back([&mutex, &order, id]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(id);
+        });
+        orders.push_back(TaskOrder{priority, now + std::chrono::milliseconds(deadline_ms)});
+    };
+    add(0, TimerPriority::Low, 1);
+    add(1, TimerPriority::High, 3);
+    add(2, TimerPriority::High, 2);
+    add(3, TimerPriority::Normal, 0);
+    executor.executeOrdered(tasks, orders);
+    ASSERT_TRUE(tasks.empty());
+    release.set_value();
+    while (executor.enqueue([&mutex, &order]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return order.size();
+    }).get() != 4) { }
+    ASSERT_TRUE((order == std::vector<int>{2, 1, 3, 0}));
+
+    // High priority jobs expired with a flood of low ones run first. Jobs
+    // are added before start, so all of them expire in one wakeup.
+    ManagerTimer mt;
+    mt.setExecutor(&executor);
+    ASSERT_TRUE(mt.init());
+    auto expiration = std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+            ManagerTimer::Clock::now());
+    std::vector<TimerPriority> ran;
+    auto post = [&](TimerPriority priority) {
+        mt.postJobRunAt(TimerOptions().setPriority(priority), expiration,
+                [&mutex, &ran, priority]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            ran.push_back(priority);
+        });
+    };
+    for (int i = 0; i < 500; ++i) {
+        post(TimerPriority::Low);
+    }
+    for (int i = 0; i < 5; ++i) {
+        post(TimerPriority::High);
+    }
+    ASSERT_TRUE(mt.start());
+    while (mt.stats().fired != 505 || mt.stats().in_flight != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mt.stopAndJoin();
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_TRUE(ran.size() == 505);
+    ASSERT_TRUE(std::count(ran.begin(), ran.begin() + 5, TimerPriority::High) == 5);
+    auto stats = mt.stats();
+    auto& high = stats.class_queue_wait[static_cast<size_t>(TimerPriority::High)];
+    auto& low = stats.class_queue_wait[static_cast<size_t>(TimerPriority::Low)];
+    ASSERT_TRUE(high.count == 5 && low.count == 500);
+}
+
+TEST (BaseFuncTest, snapshotRestore) {
+    const char* path = "timer_snapshot_test.bin";
+    std::mutex mutex;
+    std::vector<std::string> fired;
+    auto record = [&mutex, &fired](const char* arg, size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fired.emplace_back(arg, size);
+    };
+    char err[1024];
+    {
+        ManagerTimer mt;
+        ASSERT_TRUE(mt.registerCallback(1, record));
+        ASSERT_TRUE(mt.init());
+        ASSERT_TRUE(mt.addPersistentJobRunAt(std::chrono::time_point_cast<ManagerTimer::Accuracy>(
+                ManagerTimer::Clock::now()), 2, "x", 1) == nullptr);
+        ASSERT_TRUE(mt.addPersistentJobRunAfter(std::chrono::milliseconds(30), 1, "once", 4));
+        ASSERT_TRUE(mt.addPersistentJobRunEvery(std::chrono::milliseconds(20), 1, "every", 5));
+        ASSERT_TRUE(mt.addPersistentJobRunAfter(std::chrono::hours(1), 1, "later", 5));
+        ASSERT_TRUE(mt.addJobRunAfter(std::chrono::milliseconds(10), []() { }).first);
+        ASSERT_TRUE(mt.snapshot(path, err));
+    }
+    ManagerTimer mt;
+    ASSERT_FALSE(mt.restore(path, err));
+    ASSERT_TRUE(mt.registerCallback(1, record));
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.restore(path, err));
+    ASSERT_TRUE(mt.stats().pending == 3);
+    ASSERT_TRUE(mt.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(70));
+    // Job in an hour is not loaded yet, it's still saved.
+    ASSERT_FALSE(mt.restore(path, err));
+    ASSERT_TRUE(mt.snapshot(path, err));
+    mt.stopAndJoin();
+    ManagerTimer again;
+    ASSERT_TRUE(again.registerCallback(1, record));
+    ASSERT_TRUE(again.restore(path, err));
+    ASSERT_TRUE(again.stats().pending == 2);
+    // Out of range priority is rejected.
+    FILE* file = fopen(path, "r+b");
+    ASSERT_TRUE(file != nullptr);
+    fseek(file, static_cast<long>(sizeof(SnapshotHeader) + offsetof(TimerRecord, priority)),
+            SEEK_SET);
+    fputc(TimerStats::PriorityNum, file);
+    fclose(file);
+    ManagerTimer corrupt;
+    ASSERT_TRUE(corrupt.registerCallback(1, record));
+    ASSERT_FALSE(corrupt.restore(path, err));
+    ASSERT_TRUE(corrupt.stats().pending == 0);
+    remove(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_TRUE(std::count(fired.begin(), fired.end(), "once") == 1);
+    ASSERT_TRUE(std::count(fired.begin(), fired.end(), "every") >= 2);
+    ASSERT_TRUE(fired.size() > 2);
+}
+
+TEST (BaseFuncTest, missedTick) {
+    using Clock = ManagerTimer::Clock;
+    // Period is 20ms, first run is held by a gate until 90ms after its
+    // expiration, missed periods 20 ~ 80ms. Return start time of the first
+    // 'runs' runs, 'begin' is before the job is added, 'open' is when gate
+    // is opened.
+    auto run = [](const TimerOptions& options, size_t runs,
+            Clock::time_point& begin, Clock::time_point& open) {
+        ManagerTimer mt;
+        EXPECT_TRUE(mt.init());
+        EXPECT_TRUE(mt.start());
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool opened = false;
+        std::vector<Clock::time_point> starts;
+        begin = Clock::now();
+        auto timer = mt.addJobRunEvery(options, std::chrono::milliseconds(20),
+                [&mutex, &cv, &opened, &starts]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            starts.push_back(Clock::now());
+            cv.notify_all();
+            cv.wait(lock, [&opened]() { return opened; });
+        });
+        std::this_thread::sleep_until(begin + std::chrono::milliseconds(110));
+        std::unique_lock<std::mutex> lock(mutex);
+        open = Clock::now();
+        opened = true;
+        cv.notify_all();
+        cv.wait(lock, [&starts, runs]() { return starts.size() >= runs; });
+        timer->stopRepeat();
+        lock.unlock();
+        mt.stopAndJoin();
+        lock.lock();
+        starts.resize(runs);
+        return starts;
+    };
+    auto gap = [](const std::vector<Clock::time_point>& starts, size_t i) {
+        return starts[i] - starts[i - 1];
+    };
+    Clock::time_point begin;
+    Clock::time_point open;
+    // Missed periods are fired back to back.
+    auto starts = run(TimerOptions(), 3, begin, open);
+    ASSERT_TRUE(gap(starts, 2) < std::chrono::milliseconds(10));
+    // Next run at 100ms, no catch up.
+    starts = run(TimerOptions().setMissedTick(MissedTick::Skip), 3, begin, open);
+    ASSERT_TRUE(starts[1] >= begin + std::chrono::milliseconds(120));
+    ASSERT_TRUE(gap(starts, 2) >= std::chrono::milliseconds(19));
+    // 60 & 80ms are fired back to back, then 100ms.
+    starts = run(TimerOptions().setMissedTick(MissedTick::CatchUp, 2), 4, begin, open);
+    ASSERT_TRUE(gap(starts, 2) < std::chrono::milliseconds(10));
+    ASSERT_TRUE(starts[3] >= begin + std::chrono::milliseconds(120));
+    // 20ms after the first run finished.
+    starts = run(TimerOptions().setMissedTick(MissedTick::FixedDelay), 3, begin, open);
+    ASSERT_TRUE(starts[1] >= open + std::chrono::milliseconds(19));
+    ASSERT_TRUE(gap(starts, 2) >= std::chrono::milliseconds(19));
+}
+
+#ifdef TIMER_HAS_COROUTINE
+// Coroutine starts at once, frame is destroyed with the task.
+struct TestTask {
+    struct promise_type {
+        TestTask get_return_object() {
+            return TestTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+    };
+    explicit TestTask(std::coroutine_handle<promise_type> h) : handle(h) { }
+    TestTask(const TestTask&) = delete;
+    ~TestTask() { handle.destroy(); }
+    std::coroutine_handle<promise_type> handle;
+};
+
+struct ReadyValue {
+    bool await_ready() const { return true; }
+    void await_suspend(std::coroutine_handle<>) { }
+    int await_resume() const { return value; }
+    int value;
+};
+
+TEST (BaseFuncTest, coroutineAwaitable) {
+    ManagerTimer mt;
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    std::atomic_int step(0);
+    auto start = ManagerTimer::Clock::now();
+    ManagerTimer::Clock::duration slept{};
+    auto sleeper = [&]() -> TestTask {
+        co_await sleepFor(mt, std::chrono::milliseconds(20));
+        slept = ManagerTimer::Clock::now() - start;
+        bool done = co_await withTimeout(mt, sleepFor(mt, std::chrono::seconds(5)),
+                std::chrono::milliseconds(10));
+        EXPECT_FALSE(done);
+        done = co_await withTimeout(mt, sleepFor(mt, std::chrono::milliseconds(1)),
+                std::chrono::seconds(5));
+        EXPECT_TRUE(done);
+        auto value = co_await withTimeout(mt, ReadyValue{7}, std::chrono::seconds(5));
+        EXPECT_TRUE(value && *value == 7);
+        step = 1;
+    };
+    {
+        auto task = sleeper();
+        while (step != 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    ASSERT_TRUE(slept >= std::chrono::milliseconds(20));
+    // Destroying the suspended coroutine cancels its timer.
+    auto cancelled = [&]() -> TestTask {
+        co_await sleepFor(mt, std::chrono::milliseconds(50));
+        step = 2;
+    };
+    {
+        auto task = cancelled();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_TRUE(step == 1);
+    // Only the timed out 5s sleep is left.
+    ASSERT_TRUE(mt.stats().pending == 1);
+    // Dropped timer still resumes the coroutine, as a failed sleep or a
+    // timeout.
+    ThreadPool pool(2);
+    ManagerTimer bounded(&pool);
+    bounded.setMaxInFlight(1);
+    ASSERT_TRUE(bounded.init());
+    ASSERT_TRUE(bounded.start());
+    bounded.postJobRunAfter(std::chrono::milliseconds(1), []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    auto drop = TimerOptions().setOverload(OverloadPolicy::Drop);
+    auto dropped = [&]() -> TestTask {
+        auto sleep = sleepFor(bounded, drop, std::chrono::milliseconds(20));
+        co_await sleep;
+        bool slept = !sleep.dropped();
+        bool done = co_await withTimeout(bounded, drop, sleepFor(mt, std::chrono::seconds(5)),
+                std::chrono::milliseconds(10));
+        step = (slept ? 10 : 20) + (done ? 1 : 2);
+    };
+    {
+        auto task = dropped();
+        while (step == 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    ASSERT_TRUE(step == 22);
+    ASSERT_TRUE(bounded.stats().overload_drops == 2);
+    bounded.stopAndJoin();
+    mt.stopAndJoin();
+}
+#endif
+
+TEST (BaseFuncTest, cronSchedule) {
+    using SysClock = std::chrono::system_clock;
+    auto at = [](long long seconds) {
+        return SysClock::time_point(std::chrono::seconds(seconds));
+    };
+    auto utc = TimeZone::utc();
+    ASSERT_TRUE(CronSchedule::parse("61 * * * *", utc) == nullptr);
+    ASSERT_TRUE(CronSchedule::parse("* * *", utc) == nullptr);
+    ASSERT_TRUE(CronSchedule::parse("5-1 * * * *", utc) == nullptr);
+    // 2026-01-01 00:00 UTC, next Feb 29 is in 2028.
+    auto leap = CronSchedule::parse("0 0 29 2 *", utc);
+    ASSERT_TRUE(leap != nullptr);
+    ASSERT_TRUE(leap->next(at(1767225600)) == at(1835395200));
+    // Sunday 2026-10-18 12:00 UTC, next is Monday 09:00.
+    auto work = CronSchedule::parse("*/15 9-17 * * MON-FRI", utc);
+    SysClock::time_point times[3];
+    ASSERT_TRUE(work->nextTimes(at(1792324800), 3, times) == 3);
+    ASSERT_TRUE(times[0] == at(1792400400) && times[1] == at(1792401300) &&
+                times[2] == at(1792402200));
+    // Monday 2026-10-19 12:00 UTC. Day field */2 is unrestricted, so both
+    // fields must match: the next odd day on Monday is 11-09.
+    auto odd_monday = CronSchedule::parse("0 0 */2 * MON", utc);
+    ASSERT_TRUE(odd_monday->next(at(1792411200)) == at(1794182400));
+
+    // US Eastern 2026, DST from 03-08 07:00 UTC to 11-01 06:00 UTC.
+    auto eastern = std::make_shared<TimeZone>(-18000, std::vector<TimeZone::Transition>{
+            {1772953200, -14400}, {1793512800, -18000}});
+    // 02:30 is skipped on 03-08, it fires after the gap.
+    auto daily = CronSchedule::parse("30 2 * * *", eastern);
+    ASSERT_TRUE(daily->nextTimes(at(1772884800), 2, times) == 2);
+    ASSERT_TRUE(times[0] == at(1772955000) && times[1] == at(1773037800));
+    // 01:30 is repeated on 11-01, it fires once.
+    daily = CronSchedule::parse("30 1 * * *", eastern);
+    ASSERT_TRUE(daily->nextTimes(at(1793448000), 2, times) == 2);
+    ASSERT_TRUE(times[0] == at(1793511000) && times[1] == at(1793601000));
+    // Every hour follows elapsed time, 01:00 fires again after fall back.
+    auto hourly = CronSchedule::parse("@hourly", eastern);
+    ASSERT_TRUE(hourly->nextTimes(at(1793503800), 3, times) == 3);
+    ASSERT_TRUE(times[0] == at(1793505600) && times[1] == at(1793509200) &&
+                times[2] == at(1793512800));
+    auto quarter = CronSchedule::parse("*/15 * * * *", eastern);
+    ASSERT_TRUE(quarter->nextTimes(at(1793511900), 3, times) == 3);
+    ASSERT_TRUE(times[0] == at(1793512800) && times[1] == at(1793513700) &&
+                times[2] == at(1793514600));
+    // 01:45 EST then 03:00 EDT on 03-08, nothing in the gap.
+    ASSERT_TRUE(quarter->nextTimes(at(1772952300), 2, times) == 2);
+    ASSERT_TRUE(times[0] == at(1772953200) && times[1] == at(1772954100));
+    // Local zone is probed per year, far years too.
+    auto local = TimeZone::local();
+    for (time_t time : {time_t(1793512800), time_t(4102444800LL), time_t(4118083200LL)}) {
+        struct tm calendar{};
+        ASSERT_TRUE(localtime_r(&time, &calendar) != nullptr);
+        ASSERT_TRUE(local->offsetAt(time) == calendar.tm_gmtoff);
+    }
+    ASSERT_TRUE(CronSchedule::at(-1, 0, 0)->next(at(7000000000LL)) > at(7000000000LL));
+
+    ManagerTimer mt;
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    ASSERT_TRUE(mt.addJobCron("0 0 30 2 *", []() { }) == nullptr);
+    std::atomic_int count(0);
+    auto timer = mt.addJobCron("* * * * * *", [&count]() { ++count; });
+    ASSERT_TRUE(timer != nullptr);
+    ASSERT_TRUE(mt.addJobRepeatAtMinute(0, []() { }) != nullptr);
+    auto begin = std::chrono::steady_clock::now();
+    while (count < 2 && std::chrono::steady_clock::now() - begin < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(count >= 2);
+    ASSERT_TRUE(mt.cancel(timer));
+    mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, policyManager) {
+    // Heap storage & callbacks always in loop thread, thread pool is ignored.
+    BasicManagerTimer<SteadyClockPolicy, TimerHeapStorage, InlineDispatch> mt;
+    ThreadPool pool(2);
+    mt.setThreadPool(&pool);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto now = std::chrono::time_point_cast<ManagerTimer::Accuracy>(ManagerTimer::Clock::now());
+    std::mutex mutex;
+    std::vector<int> order;
+    std::set<std::thread::id> threads;
+    std::vector<ManagerTimer::TimerHandle> timers;
+    for (int i = 0; i < 200; ++i) {
+        int delay = (i * 37) % 200;
+        timers.push_back(mt.postJobRunAt(now + std::chrono::milliseconds(50 + delay),
+                [&mutex, &order, &threads, delay]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(delay);
+            threads.insert(std::this_thread::get_id());
+        }));
+    }
+    for (size_t i = 0; i < timers.size(); i += 3) {
+        ASSERT_TRUE(mt.cancel(timers[i]));
+    }
+    ASSERT_TRUE(mt.extend(timers[1], now + std::chrono::milliseconds(300)));
+    while (mt.stats().pending != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    mt.stopAndJoin();
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_TRUE(order.size() == 133);
+    ASSERT_TRUE(order.back() == 37);
+    order.pop_back();
+    ASSERT_TRUE(std::is_sorted(order.begin(), order.end()));
+    ASSERT_TRUE(threads.size() == 1 && threads.count(std::this_thread::get_id()) == 0);
+    // setTimingWheel() doesn't compile with storage that can't hold a wheel.
+    static_assert(ManagerTimer::TimingWheelCapable, "");
+    static_assert(BasicManagerTimer<SteadyClockPolicy, TimingWheelStorage>::TimingWheelCapable, "");
+    static_assert(!BasicManagerTimer<SteadyClockPolicy, TimerHeapStorage>::TimingWheelCapable, "");
+    BasicManagerTimer<SteadyClockPolicy, TimingWheelStorage, InlineDispatch> wheel;
+    ASSERT_TRUE(wheel.setTimingWheel(std::chrono::milliseconds(2), 2));
+    ASSERT_TRUE(wheel.init());
+    ASSERT_TRUE(wheel.start());
+    auto pair = wheel.addJobRunAfter(std::chrono::milliseconds(5), []() { return 1; });
+    ASSERT_TRUE(pair.second.get() == 1);
+    wheel.stopAndJoin();
+}
+
+TEST (BaseFuncTest, clockPolicy) {
+    auto near = [](std::chrono::steady_clock::time_point time) {
+        auto diff = time - std::chrono::steady_clock::now();
+        return diff < std::chrono::milliseconds(10) && diff > -std::chrono::milliseconds(10);
+    };
+    ASSERT_TRUE(near(CoarseClockPolicy::now()));
+    TscClockPolicy::init();
+    ASSERT_TRUE(near(TscClockPolicy::now()));
+    auto last = TscClockPolicy::now();
+    for (int i = 0; i < 1000; ++i) {
+        auto now = TscClockPolicy::now();
+        ASSERT_TRUE(now >= last);
+        last = now;
+    }
+    // Cached time only moves at wakeup.
+    auto cached = CachedClockPolicy<>::wakeup();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    ASSERT_TRUE(CachedClockPolicy<>::now() == cached);
+    ASSERT_TRUE(CachedClockPolicy<>::wakeup() > cached);
+
+    BasicManagerTimer<TscClockPolicy> mt;
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto begin = std::chrono::steady_clock::now();
+    auto pair = mt.addJobRunAfter(std::chrono::milliseconds(20), [begin]() {
+        return std::chrono::steady_clock::now() - begin;
+    });
+    auto elapse = pair.second.get();
+    ASSERT_TRUE(elapse >= std::chrono::milliseconds(19) && elapse < std::chrono::milliseconds(200));
+    mt.stopAndJoin();
+    // Cached time is stale while loop sleeps, job after it isn't early.
+    BasicManagerTimer<CachedClockPolicy<>> cached_mt;
+    ASSERT_TRUE(cached_mt.init());
+    ASSERT_TRUE(cached_mt.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    begin = std::chrono::steady_clock::now();
+    pair = cached_mt.addJobRunAfter(std::chrono::milliseconds(20), [begin]() {
+        return std::chrono::steady_clock::now() - begin;
+    });
+    elapse = pair.second.get();
+    ASSERT_TRUE(elapse >= std::chrono::milliseconds(19) && elapse < std::chrono::milliseconds(200));
+    cached_mt.stopAndJoin();
+}
+
+TEST (BaseFuncTest, cancelGroup) {
+    for (bool lock_free : {false, true}) {
+        ManagerTimer mt;
+        ASSERT_TRUE(mt.setLockFreeSubmit(lock_free));
+        ASSERT_TRUE(mt.init());
+        ASSERT_TRUE(mt.start());
+        auto session = std::make_shared<TimerGroup>();
+        auto options = TimerOptions().setGroup(session);
+        std::atomic_int fired(0);
+        auto arg = std::make_shared<int>(0);
+        for (int i = 0; i < 10; ++i) {
+            mt.postJobRunAfter(options, std::chrono::milliseconds(50 + i),
+                    [&fired, arg]() { ++fired; });
+        }
+        auto keepalive = mt.addJobRunEvery(options, std::chrono::milliseconds(5),
+                [&fired]() { ++fired; });
+        auto other = mt.addJobRunAfter(std::chrono::milliseconds(50), [&fired]() { ++fired; });
+        // Wait until keepalive is repeating.
+        while (fired == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(session->pending() == 11 || session->pending() == 10);
+        ASSERT_TRUE(mt.cancelGroup(session) >= 10);
+        // Let a running keepalive finish.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        int before = fired;
+        other.second.get();
+        ASSERT_TRUE(fired == before + 1);
+        ASSERT_TRUE(session->pending() == 0);
+        ASSERT_TRUE(mt.stats().pending == 0);
+        // Bound arguments are released.
+        ASSERT_TRUE(arg.use_count() == 1);
+        ASSERT_TRUE(keepalive->isCancelled());
+        // Group can be used again.
+        auto pair = mt.addJobRunAfter(options, std::chrono::milliseconds(1), []() { return 1; });
+        ASSERT_TRUE(pair.second.get() == 1);
+        // Repeat job dropped by its group when added back, its callback is
+        // destroyed out of lock and may add jobs.
+        std::atomic_bool posted(false);
+        std::shared_ptr<void> poster(nullptr, [&mt, &posted](void*) {
+            mt.postJobRunAfter(std::chrono::milliseconds(1), [&posted]() { posted = true; });
+        });
+        mt.addJobRunEvery(options, std::chrono::milliseconds(1), [&mt, session, poster]() {
+            mt.cancelGroup(session);
+        });
+        poster.reset();
+        while (!posted) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        mt.stopAndJoin();
+    }
+}
+
+TEST (BaseFuncTest, overloadPolicy) {
+    ThreadPool pool(4);
+    ManagerTimer mt;
+    mt.setThreadPool(&pool);
+    mt.setMaxInFlight(1);
+    ASSERT_TRUE(mt.init());
+    ASSERT_TRUE(mt.start());
+    auto busy = mt.addJobRunAfter(std::chrono::milliseconds(10), []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    auto dropped = mt.addJobRunAfter(TimerOptions().setOverload(OverloadPolicy::Drop),
+            std::chrono::milliseconds(30), []() { return 1; });
+    auto inlined = mt.addJobRunAfter(TimerOptions().setOverload(OverloadPolicy::Inline),
+            std::chrono::milliseconds(40), []() { return std::this_thread::get_id(); });
+    auto blocked = mt.addJobRunAfter(std::chrono::milliseconds(50),
+            []() { return std::this_thread::get_id(); });
+    // Inline one ran in loop thread, the blocked one waited for busy.
+    auto inline_id = inlined.second.get();
+    auto block_id = blocked.second.get();
+    ASSERT_TRUE(busy.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    ASSERT_TRUE(inline_id != std::this_thread::get_id());
+    ASSERT_TRUE(inline_id != block_id);
+    ASSERT_TRUE(dropped.first->isOverTime());
+    TimerStats stats = mt.stats();
+    ASSERT_TRUE(stats.overload_drops == 1);
+    ASSERT_TRUE(stats.overload_inline == 1);
+    ASSERT_TRUE(stats.overload_blocks == 1);
+    ASSERT_TRUE(stats.over_time_drops == 0);
+    mt.stopAndJoin();
+}
+
 TEST (BaseFuncTest, addTimerAtTime) {
     auto now = std::chrono::system_clock::now();
     auto c_time_t = std::chrono::system_clock::to_time_t(now);
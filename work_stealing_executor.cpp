@@ -0,0 +1,141 @@
+#include "work_stealing_executor.h"
+
+#include <algorithm>
+
+// Executor & worker index of current thread.
+static thread_local const WorkStealingExecutor* current_executor = nullptr;
+static thread_local size_t current_index = 0;
+
+WorkStealingExecutor::WorkStealingExecutor(size_t threads) :
+        next_(0),
+        queued_(0),
+        sleeping_(0),
+        stop_(false) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(new Worker);
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkStealingExecutor::run, this, i);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool WorkStealingExecutor::setThreadOptions(const ThreadOptions& options, char* err) {
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        if (!applyThreadOptions(threads_[i].native_handle(), options,
+                static_cast<int>(i), err)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void WorkStealingExecutor::execute(Callback task) {
+    size_t index = current_executor == this ?
+            current_index : next_++ % workers_.size();
+    // Count first, so queued_ never goes below real count.
+    // Worker increases sleeping_ before checking queued_, one of them
+    // must see the other.
+    ++queued_;
+    {
+        Worker& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    if (sleeping_ != 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+}
+
+void WorkStealingExecutor::executeBatch(std::vector<Callback>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    size_t worker_num = workers_.size();
+    size_t per_worker = (tasks.size() + worker_num - 1) / worker_num;
+    size_t index = current_executor == this ?
+            current_index : next_++ % worker_num;
+    queued_ += tasks.size();
+    size_t used = 0;
+    for (size_t begin = 0; begin < tasks.size(); begin += per_worker) {
+        size_t end = std::min(begin + per_worker, tasks.size());
+        Worker& worker = *workers_[(index + used) % worker_num];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        for (size_t i = begin; i < end; ++i) {
+            worker.tasks.push_back(std::move(tasks[i]));
+        }
+        ++used;
+    }
+    tasks.clear();
+    size_t sleeping = sleeping_;
+    if (sleeping != 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        if (used >= sleeping) {
+            sleep_cv_.notify_all();
+        } else {
+            for (size_t i = 0; i < used; ++i) {
+                sleep_cv_.notify_one();
+            }
+        }
+    }
+}
+
+void WorkStealingExecutor::run(size_t index) {
+    current_executor = this;
+    current_index = index;
+    Callback task;
+    for (;;) {
+        if (popTask(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        ++sleeping_;
+        sleep_cv_.wait(lock, [this]() {
+            return queued_ != 0 || stop_;
+        });
+        --sleeping_;
+        if (stop_ && queued_ == 0) {
+            break;
+        }
+    }
+}
+
+bool WorkStealingExecutor::popTask(size_t index, Callback& task) {
+    if (queued_ == 0) {
+        return false;
+    }
+    // Own deque first, then steal from others.
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        } else {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        --queued_;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,72 @@
+#ifndef WORK_STEALING_EXECUTOR_H
+#define WORK_STEALING_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "timer_executor.h"
+#include "timer_thread.h"
+
+// Every worker has its own task deque. Tasks from outside are spread over
+// workers round robin, tasks from a worker go to its own deque. Idle worker
+// steals from others, sleeping workers are notified only when needed.
+// Remaining tasks are run before destroyed.
+class WorkStealingExecutor final : public TimerExecutor {
+public:
+    explicit WorkStealingExecutor(size_t threads);
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator= (const WorkStealingExecutor&) = delete;
+    ~WorkStealingExecutor() override;
+
+    void execute(Callback task) override;
+    // Tasks are split over workers, one lock per worker, and only as many
+    // sleeping workers as used deques are woken.
+    void executeBatch(std::vector<Callback>& tasks) override;
+    // Same as ThreadPool::enqueue.
+    template <typename F, typename... Args>
+    auto enqueue(F&& f, Args&&... args)
+            -> std::future<typename std::result_of<F(Args...)>::type>;
+    size_t size() const {
+        return threads_.size();
+    }
+    // Placement of workers, worker i is named "name-i".
+    bool setThreadOptions(const ThreadOptions& options, char* err = nullptr);
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Callback> tasks; // Protect by mutex
+    };
+    void run(size_t index);
+    bool popTask(size_t index, Callback& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_; // Round robin of outside tasks
+    std::atomic<size_t> queued_; // Tasks in all deques
+    std::atomic<size_t> sleeping_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_; // Protect by sleep_mutex_
+};
+
+template <typename F, typename... Args>
+auto WorkStealingExecutor::enqueue(F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type> {
+    using return_type = typename std::result_of<F(Args...)>::type;
+    std::packaged_task<return_type()> task(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    auto future = task.get_future();
+    execute(std::move(task));
+    return future;
+}
+
+#endif //WORK_STEALING_EXECUTOR_H